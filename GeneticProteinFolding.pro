@@ -13,9 +13,21 @@ TEMPLATE = app
 
 
 SOURCES += main.cpp\
-        mainwindow.cpp
-
-HEADERS  += mainwindow.h
+        mainwindow.cpp\
+        proteinrenderer.cpp\
+        foldingdaemon.cpp\
+        islandcluster.cpp\
+        searchworker.cpp
+
+HEADERS  += mainwindow.h\
+        proteinrenderer.h\
+        foldingdaemon.h\
+        islandcluster.h\
+        searchworker.h\
+        snapshotslot.h
+
+# Folding core, also built on its own as libfolding (libfolding.pro)
+include(folding.pri)
 
 FORMS    += mainwindow.ui
 
@@ -24,3 +36,4 @@ DISTFILES += \
 
 # My Settings
 CONFIG += console
+CONFIG += c++14 thread
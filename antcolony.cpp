@@ -0,0 +1,346 @@
+#include "antcolony.h"
+#include "localsearch.h"
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+
+// Direction after turning t (0 straight, 1 left, 2 right) from direction d (1=N, 2=E, 3=S, 4=W)
+static inline int turned(int d, int t) {
+    if(t == 1) {
+        return (d + 2) % 4 + 1;
+    } else if(t == 2) {
+        return d % 4 + 1;
+    }
+    return d;
+}
+
+static const int stepX[5] = { 0, 0, 1, 0, -1 };
+static const int stepY[5] = { 0, -1, 0, 1, 0 };
+
+
+AntColonyEngine::AntColonyEngine(const string &proteinSequence, int targetFitness, const foldingOptions &options) :
+    FoldingEngine(targetFitness),
+    proteinSequence(proteinSequence),
+    hIndex(buildContactIndex(proteinSequence, getEnergyModel(options))),
+    options(options),
+    phase(0),
+    meanAntFitness(0),
+    colonyNum(0),
+    pool(min(max(1, options.acoAnts), engineThreadCount(options)))
+{
+    // Ants start at a random residue, so there has to be one
+    if(proteinSequence.empty()) {
+        throw invalid_argument("ant colony needs a non-empty sequence");
+    }
+
+    length = proteinSequence.size();
+    numTurns = max(length - 2, 0);
+    numAnts = max(1, options.acoAnts);
+    numElites = min(max(options.acoElites, 1), numAnts);
+
+    // Heuristic in units of the strongest attraction, one H-H contact for the HP model
+    int minPair = 0;
+    for(size_t p=0;p<hIndex.pairEnergy.size();p++) {
+        minPair = min(minPair, hIndex.pairEnergy[p]);
+    }
+    energyUnit = minPair < 0 ? -minPair : 1;
+
+    // Max-min bounds: every turn keeps at least 1/(2 length) of the most a turn can have
+    pheromone.assign(numTurns * 3, 1.0);
+    minPheromone = 1.0 / (2 * max(length, 1));
+
+    ants.resize(numAnts);
+    ranking.resize(numAnts);
+
+    bestNode.proteinDirection = createRandomSequence(length, options.maxFitnessLimit);
+    bestNode.fitness = getFitnessRating(hIndex, bestNode.proteinDirection);
+    turnsOf(bestNode.proteinDirection, bestTurns);
+
+    int numWorkers = pool.size();
+    int side = 2 * length + 1;
+    scratches.resize(numWorkers);
+    for(int w=0;w<numWorkers;w++) {
+        workerScratch &s = scratches[w];
+        s.cellResidue.assign((size_t)side * side, -1);
+        s.xs.resize(length);
+        s.ys.resize(length);
+        s.dirs.resize(length);
+        s.growUp.resize(length);
+        s.gained.resize(length);
+        s.tried.resize(length);
+    }
+}
+
+
+// Every thread of the pool takes ants off its counter until the phase has none left
+void AntColonyEngine::runPhase(int newPhase, int numJobs) {
+    phase = newPhase;
+    pool.run(numJobs, [this](int k, int workerIndex) {
+        if(phase == 0) {
+            buildAnt(scratches[workerIndex], ants[k]);
+        } else {
+            ant &a = ants[ranking[k]];
+            a.fold.fitness = polishFold(hIndex, a.fold.proteinDirection, a.fold.fitness, options.acoPolishMoves);
+            turnsOf(a.fold.proteinDirection, a.turns);
+        }
+    });
+}
+
+
+void AntColonyEngine::buildAnt(workerScratch &s, ant &a) {
+    int side = 2 * length + 1;
+    auto cellOf = [&](int x, int y) { return (y + length) * side + (x + length); };
+    // Backing up this often means the ant walked into a pocket, it starts over instead
+    int maxBacktracks = 100 * length;
+
+    a.turns.resize(numTurns);
+    a.fold.proteinDirection.assign(length, '0');
+
+    bool built = false;
+    while(!built) {
+        // Start at a random residue with its next (or, at the end, previous) neighbour to the east
+        int start = foldRand() % length;
+        int lo = start;
+        int hi = start;
+        s.xs[start] = 0;
+        s.ys[start] = 0;
+        s.cellResidue[cellOf(0, 0)] = start;
+        if(length > 1) {
+            int second = start < length - 1 ? start + 1 : start - 1;
+            s.xs[second] = second - start;
+            s.ys[second] = 0;
+            s.cellResidue[cellOf(s.xs[second], 0)] = second;
+            lo = min(start, second);
+            hi = max(start, second);
+            s.dirs[hi] = 2;
+        }
+
+        int energy = 0;
+        int backtracks = 0;
+        int depth = 0;
+        bool stuck = false;
+        bool newDepth = true;
+
+        // Each depth adds one residue at the end it picked, until the chain is complete
+        while(depth < length - 2) {
+            if(newDepth) {
+                // Grow towards whichever end is still open, either when both are
+                if(lo == 0) {
+                    s.growUp[depth] = 1;
+                } else if(hi == length - 1) {
+                    s.growUp[depth] = 0;
+                } else {
+                    s.growUp[depth] = foldRand() % 2;
+                }
+                s.tried[depth] = 0;
+                newDepth = false;
+            }
+
+            bool up = s.growUp[depth];
+            // The residue placed, the one it bonds to, and the residue whose turn it sets
+            int next = up ? hi + 1 : lo - 1;
+            int anchor = up ? hi : lo;
+            double weights[3];
+            int gains[3];
+            int moveDirs[3];
+            double total = 0;
+            int numFree = 0;
+            int freeTurns = 0;
+            for(int t=0;t<3;t++) {
+                weights[t] = 0;
+                if(s.tried[depth] & (1 << t)) {
+                    continue;
+                }
+                // Going down, the bond into the anchor is picked so the anchor turns t
+                int dir = up ? turned(s.dirs[hi], t) : turned(s.dirs[lo+1], t == 0 ? 0 : 3 - t);
+                int x = up ? s.xs[anchor] + stepX[dir] : s.xs[anchor] - stepX[dir];
+                int y = up ? s.ys[anchor] + stepY[dir] : s.ys[anchor] - stepY[dir];
+                if(s.cellResidue[cellOf(x, y)] >= 0) {
+                    continue;
+                }
+
+                int gain = 0;
+                if(hIndex.siteTypes[next] >= 0) {
+                    for(int d=1;d<=4;d++) {
+                        int other = s.cellResidue[cellOf(x + stepX[d], y + stepY[d])];
+                        if(other >= 0 && other != anchor && hIndex.siteTypes[other] >= 0) {
+                            gain += contactEnergy(hIndex, next, other);
+                        }
+                    }
+                }
+
+                moveDirs[t] = dir;
+                gains[t] = gain;
+                weights[t] = pow(pheromone[(anchor - 1) * 3 + t], options.acoAlpha) * exp(-options.acoBeta * gain / energyUnit);
+                total += weights[t];
+                numFree++;
+                freeTurns |= 1 << t;
+            }
+
+            if(numFree == 0) {
+                if(depth == 0 || ++backtracks > maxBacktracks) {
+                    stuck = true;
+                    break;
+                }
+                // Take back the last residue and rule out the turn that placed it
+                depth--;
+                int last = s.growUp[depth] ? hi-- : lo++;
+                s.cellResidue[cellOf(s.xs[last], s.ys[last])] = -1;
+                energy -= s.gained[depth];
+                int lastAnchor = s.growUp[depth] ? hi : lo;
+                s.tried[depth] |= 1 << a.turns[lastAnchor - 1];
+                continue;
+            }
+
+            // Roulette over the free cells, evenly if every weight underflowed
+            int choice = -1;
+            if(total > 0) {
+                double pick = foldRand() / 2147483648.0 * total;
+                for(int t=0;t<3;t++) {
+                    if(weights[t] > 0) {
+                        choice = t;
+                        pick -= weights[t];
+                        if(pick < 0) {
+                            break;
+                        }
+                    }
+                }
+            }
+            if(choice < 0) {
+                int pick = foldRand() % numFree;
+                for(int t=0;t<3 && choice<0;t++) {
+                    if((freeTurns & (1 << t)) && pick-- == 0) {
+                        choice = t;
+                    }
+                }
+            }
+
+            int dir = moveDirs[choice];
+            if(up) {
+                s.dirs[next] = dir;
+                s.xs[next] = s.xs[anchor] + stepX[dir];
+                s.ys[next] = s.ys[anchor] + stepY[dir];
+                hi = next;
+            } else {
+                s.dirs[anchor] = dir;
+                s.xs[next] = s.xs[anchor] - stepX[dir];
+                s.ys[next] = s.ys[anchor] - stepY[dir];
+                lo = next;
+            }
+            s.cellResidue[cellOf(s.xs[next], s.ys[next])] = next;
+            s.gained[depth] = gains[choice];
+            energy += gains[choice];
+            a.turns[anchor - 1] = choice;
+
+            depth++;
+            newDepth = true;
+        }
+
+        built = !stuck;
+        if(built) {
+            for(int r=1;r<length;r++) {
+                a.fold.proteinDirection[r-1] = '0' + s.dirs[r];
+            }
+            a.fold.fitness = energy;
+        }
+
+        // Residues lo to hi are on the lattice either way
+        for(int r=lo;r<=hi;r++) {
+            s.cellResidue[cellOf(s.xs[r], s.ys[r])] = -1;
+        }
+    }
+}
+
+
+// Turns of a fold as the ants make them, whatever direction it starts in
+void AntColonyEngine::turnsOf(const string &proteinDirection, vector<char> &turns) const {
+    turns.resize(numTurns);
+    for(int t=0;t<numTurns;t++) {
+        int delta = (proteinDirection[t+1] - proteinDirection[t] + 4) & 3;
+        turns[t] = delta == 3 ? 1 : (delta == 1 ? 2 : 0);
+    }
+}
+
+void AntColonyEngine::deposit(const vector<char> &turns, double amount) {
+    for(int t=0;t<numTurns;t++) {
+        pheromone[t * 3 + turns[t]] += amount;
+    }
+}
+
+
+bool AntColonyEngine::step() {
+    runPhase(0, numAnts);
+    colonyNum++;
+
+    for(int k=0;k<numAnts;k++) {
+        ranking[k] = k;
+    }
+    partial_sort(ranking.begin(), ranking.begin() + numElites, ranking.end(), [&](int a, int b) {
+        return ants[a].fold.fitness < ants[b].fold.fitness;
+    });
+
+    double totalFitness = 0;
+    for(int k=0;k<numAnts;k++) {
+        totalFitness += ants[k].fold.fitness;
+    }
+    meanAntFitness = totalFitness / numAnts;
+
+    if(options.acoPolishMoves > 0) {
+        runPhase(1, numElites);
+    }
+
+    for(int e=0;e<numElites;e++) {
+        const ant &a = ants[ranking[e]];
+        if(a.fold.fitness < bestNode.fitness) {
+            bestNode = a.fold;
+            bestTurns = a.turns;
+        }
+    }
+
+    // Batch update while no ant is out: evaporate, then the elites and the best fold lay pheromone
+    double persistence = 1.0 - options.acoEvaporation;
+    for(size_t p=0;p<pheromone.size();p++) {
+        pheromone[p] *= persistence;
+    }
+    if(bestNode.fitness < 0) {
+        double share = options.acoEvaporation / (numElites + 1);
+        for(int e=0;e<numElites;e++) {
+            const ant &a = ants[ranking[e]];
+            double quality = min(max((double)a.fold.fitness / bestNode.fitness, 0.0), 1.0);
+            deposit(a.turns, share * quality);
+        }
+        deposit(bestTurns, share);
+    }
+    for(size_t p=0;p<pheromone.size();p++) {
+        pheromone[p] = min(max(pheromone[p], minPheromone), 1.0);
+    }
+
+    return bestNode.fitness <= targetFitness;
+}
+
+
+// Only called between colonies, while the pool is idle
+void AntColonyEngine::seedFolds(const vector<string> &folds) {
+    vector<char> turns;
+    for(size_t k=0;k<folds.size();k++) {
+        proteinNode seed;
+        seed.proteinDirection = folds[k];
+        seed.fitness = getFitnessRating(hIndex, seed.proteinDirection);
+        turnsOf(seed.proteinDirection, turns);
+        if(seed.fitness < bestNode.fitness) {
+            bestNode = seed;
+            bestTurns = turns;
+        }
+        if(bestNode.fitness < 0) {
+            double quality = min(max((double)seed.fitness / bestNode.fitness, 0.0), 1.0);
+            deposit(turns, options.acoEvaporation / (numElites + 1) * quality);
+        }
+    }
+    for(size_t p=0;p<pheromone.size();p++) {
+        pheromone[p] = min(pheromone[p], 1.0);
+    }
+}
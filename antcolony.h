@@ -0,0 +1,105 @@
+#ifndef ANTCOLONY_H
+#define ANTCOLONY_H
+
+#include <string>
+#include <vector>
+
+#include "foldingengine.h"
+#include "workerpool.h"
+
+// Ant colony optimisation: every step() a colony of acoAnts ants builds folds
+// residue by residue, the best are polished by local search and lay
+// pheromone, which steers the next colony.
+//
+// An ant starts at a random residue and grows the chain at either end, one
+// residue at a time. Adding a residue next to residue i makes the chain turn
+// straight, left or right at i; the ant picks among the free cells with
+// weight tau^alpha * eta^beta, where tau is the pheromone on that turn at
+// residue i and eta = exp(-dE / unit), dE being the contact energy the new
+// residue gains there and unit the strongest attractive pair energy of the
+// model, so each H-H contact an HP ant makes weighs e^beta. When no cell is
+// free the ant backs up and tries the turns it has not tried yet.
+//
+// Ants are built and polished in parallel on the engine's worker pool. The
+// pheromone is only read while they run and is updated in one batch between
+// colonies: it evaporates by acoEvaporation, then the acoElites best polished
+// ants and the best fold so far each add their share of fitness / best
+// fitness, max-min bounded so no turn is ever ruled out.
+class AntColonyEngine : public FoldingEngine
+{
+public:
+    // Throws std::invalid_argument for an empty sequence
+    AntColonyEngine(const std::string &proteinSequence, int targetFitness, const foldingOptions &options);
+
+    bool step();
+    // Seeds lay pheromone like the best fold
+    void seedFolds(const std::vector<std::string> &folds);
+
+    const proteinNode &best() const { return bestNode; }
+    int generation() const { return colonyNum; }
+
+    int getNumAnts() const { return numAnts; }
+    // Pheromone on turn (0 straight, 1 left, 2 right) after residue i, 1 <= i < length - 1
+    double getPheromone(int i, int turn) const { return pheromone[(i - 1) * 3 + turn]; }
+    // Mean fitness of the last colony's ants as built, before polishing
+    double getMeanAntFitness() const { return meanAntFitness; }
+
+private:
+    struct ant {
+        proteinNode fold;
+        // Turn after every residue but the ends
+        std::vector<char> turns;
+
+        // Keeps ants built on different threads off each other's cache lines
+        char padding[64];
+    };
+
+    // One worker thread's lattice and backtracking state
+    struct workerScratch {
+        std::vector<int> cellResidue;
+        std::vector<int> xs;
+        std::vector<int> ys;
+        std::vector<char> dirs;
+        // Per residue added: the end it went on, the energy it gained, the turns tried
+        std::vector<char> growUp;
+        std::vector<int> gained;
+        std::vector<char> tried;
+
+        char padding[64];
+    };
+
+    void buildAnt(workerScratch &scratch, ant &a);
+    void turnsOf(const std::string &proteinDirection, std::vector<char> &turns) const;
+    void deposit(const std::vector<char> &turns, double amount);
+    void runPhase(int newPhase, int numJobs);
+
+    std::string proteinSequence;
+    contactIndex hIndex;
+    foldingOptions options;
+
+    int length;
+    int numTurns;
+    int numAnts;
+    int numElites;
+    double energyUnit;
+    double minPheromone;
+    std::vector<double> pheromone;
+
+    std::vector<ant> ants;
+    // Ants ranked best first, the first numElites are polished
+    std::vector<int> ranking;
+    std::vector<workerScratch> scratches;
+
+    // 0 while building, 1 while polishing
+    int phase;
+
+    proteinNode bestNode;
+    std::vector<char> bestTurns;
+    double meanAntFitness;
+    int colonyNum;
+
+    // Last, so it is gone before anything its threads touch
+    WorkerPool pool;
+};
+
+#endif // ANTCOLONY_H
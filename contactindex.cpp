@@ -0,0 +1,178 @@
+#include "contactindex.h"
+#include "fixedlength.h"
+#include "perfcounters.h"
+
+#include <cstdint>
+#include <cctype>
+
+using namespace std;
+
+
+// Scratch space for scoring, kept per thread so the kernel does not allocate
+// once it has seen the longest sequence
+struct contactScratch {
+    vector<int> contactX;
+    vector<int> contactY;
+
+    // Open addressing table of packed coordinates -> chain index,
+    // a value of -1 marks an empty bucket
+    vector<uint64_t> keys;
+    vector<int> values;
+};
+
+static thread_local contactScratch scratch;
+
+static inline size_t hashCoordinate(uint64_t key, size_t mask) {
+    key ^= key >> 29;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 32;
+    return key & mask;
+}
+
+
+contactIndex buildContactIndex(const string &proteinSequence) {
+    return buildContactIndex(proteinSequence, hpEnergyModel());
+}
+
+contactIndex buildContactIndex(const string &proteinSequence, const energyModel &model) {
+    contactIndex hIndex;
+    hIndex.length = proteinSequence.size();
+    hIndex.numTypes = model.alphabet.size();
+    hIndex.pairEnergy = model.pairEnergy;
+
+    // Types that never change the energy are left out of the search
+    vector<int> typeOf(256, -1);
+    for(int k=0;k<hIndex.numTypes;k++) {
+        bool contributes = false;
+        for(int j=0;j<hIndex.numTypes;j++) {
+            contributes = contributes || model.pairEnergy[k*hIndex.numTypes + j] != 0;
+        }
+        if(contributes) {
+            typeOf[(unsigned char)tolower(model.alphabet[k])] = k;
+            typeOf[(unsigned char)toupper(model.alphabet[k])] = k;
+        }
+    }
+
+    hIndex.siteTypes.resize(hIndex.length);
+    for(int i=0;i<hIndex.length;i++) {
+        int type = typeOf[(unsigned char)proteinSequence[i]];
+        hIndex.siteTypes[i] = type;
+        if(type >= 0) {
+            int slot = hIndex.contactPositions.size();
+            hIndex.contactPositions.push_back(i);
+            hIndex.contactTypes.push_back(type);
+
+            if(i % 2 == 0) {
+                hIndex.evenSlots.push_back(slot);
+            } else {
+                hIndex.oddSlots.push_back(slot);
+            }
+        }
+    }
+
+    return hIndex;
+}
+
+
+int getFitnessRating(const contactIndex &hIndex, const string &proteinDirection) {
+    KernelProbe probe(kernelFitness);
+    if(hIndex.length == (int)proteinDirection.size()) {
+        if(const fixedLengthKernels *fixed = findFixedKernels(hIndex.length)) {
+            return fixed->getFitnessRating(hIndex, proteinDirection);
+        }
+    }
+    const vector<int> &positions = hIndex.contactPositions;
+    int numContactResidues = positions.size();
+    if(hIndex.evenSlots.empty() || hIndex.oddSlots.empty()) {
+        return 0;
+    }
+
+    // Walk the chain, only keeping the coordinates of the contact residues
+    scratch.contactX.resize(numContactResidues);
+    scratch.contactY.resize(numContactResidues);
+
+    int currX = 0;
+    int currY = 0;
+    int nextContact = 0;
+    int length = proteinDirection.size();
+    int lastContact = positions[numContactResidues-1];
+    for(int i=0;i<=lastContact && i<length;i++) {
+        if(i == positions[nextContact]) {
+            scratch.contactX[nextContact] = currX;
+            scratch.contactY[nextContact] = currY;
+            nextContact++;
+        }
+
+        char currentDirection = proteinDirection[i];
+        if(currentDirection == '1') {
+            currY--;
+        }
+        else if(currentDirection == '2') {
+            currX++;
+        }
+        else if(currentDirection == '3') {
+            currY++;
+        }
+        else if(currentDirection == '4') {
+            currX--;
+        }
+    }
+
+    // Hash the larger parity class, probe around the smaller one
+    const vector<int> *stored = &hIndex.evenSlots;
+    const vector<int> *probed = &hIndex.oddSlots;
+    if(stored->size() < probed->size()) {
+        swap(stored, probed);
+    }
+
+    size_t tableSize = 16;
+    while(tableSize < stored->size() * 2) {
+        tableSize *= 2;
+    }
+    size_t mask = tableSize - 1;
+    scratch.keys.resize(tableSize);
+    scratch.values.assign(tableSize, -1);
+
+    for(int slot : *stored) {
+        if(slot >= nextContact) {
+            continue;
+        }
+        uint64_t key = packCoordinate(scratch.contactX[slot], scratch.contactY[slot]);
+        size_t bucket = hashCoordinate(key, mask);
+        while(scratch.values[bucket] >= 0) {
+            bucket = (bucket + 1) & mask;
+        }
+        scratch.keys[bucket] = key;
+        scratch.values[bucket] = slot;
+    }
+
+    static const int offsetX[4] = { 0, 1, 0, -1 };
+    static const int offsetY[4] = { -1, 0, 1, 0 };
+
+    // Every contact pairs an even with an odd residue, so each is seen once
+    int fitness = 0;
+    for(int slot : *probed) {
+        if(slot >= nextContact) {
+            continue;
+        }
+        int position = positions[slot];
+        const int *energyRow = &hIndex.pairEnergy[hIndex.contactTypes[slot] * hIndex.numTypes];
+        for(int d=0;d<4;d++) {
+            uint64_t key = packCoordinate(scratch.contactX[slot] + offsetX[d], scratch.contactY[slot] + offsetY[d]);
+            size_t bucket = hashCoordinate(key, mask);
+            while(scratch.values[bucket] >= 0) {
+                if(scratch.keys[bucket] == key) {
+                    int otherSlot = scratch.values[bucket];
+                    int other = positions[otherSlot];
+                    // Chain neighbours are bonded, not contacts: masked out instead of branched on
+                    int bonded = (other - position == 1) | (position - other == 1);
+                    fitness += energyRow[hIndex.contactTypes[otherSlot]] & (bonded - 1);
+                    break;
+                }
+                bucket = (bucket + 1) & mask;
+            }
+        }
+    }
+
+    return fitness;
+}
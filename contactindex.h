@@ -0,0 +1,63 @@
+#ifndef CONTACTINDEX_H
+#define CONTACTINDEX_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "energymodel.h"
+
+// Per-sequence index of the residues that can make contacts, built once per
+// test case for an energy model (the H residues for the HP model).
+//
+// On the square lattice two residues can only touch if their chain indices
+// have opposite parity, so the contact residues are split into even and odd
+// lists. Scoring hashes the coordinates of one list and probes the four
+// neighbours of the other, which makes the contact search scale with the
+// number of contact residues instead of the chain length times the
+// neighbourhood. Each contact found is scored with one lookup in the dense
+// residue-type pair table.
+struct contactIndex {
+    int length;
+
+    // Residue types and their fixed-point pair energies, copied from the model
+    int numTypes;
+    std::vector<int> pairEnergy;
+
+    // Type of every residue, -1 for residues whose contacts are all worth 0
+    std::vector<int> siteTypes;
+
+    // Sorted chain indices of every contact residue, and their types
+    std::vector<int> contactPositions;
+    std::vector<int> contactTypes;
+
+    // Which of contactPositions are even and odd, as offsets into contactPositions
+    std::vector<int> evenSlots;
+    std::vector<int> oddSlots;
+};
+
+// Index for the HP model
+contactIndex buildContactIndex(const std::string &proteinSequence);
+contactIndex buildContactIndex(const std::string &proteinSequence, const energyModel &model);
+
+// Fitness of a (collision free) directional sequence: the fixed-point energy
+// of its contacts, -1 per H-H contact with the HP model
+int getFitnessRating(const contactIndex &hIndex, const std::string &proteinDirection);
+
+// One key for a lattice cell, negative coordinates included
+inline uint64_t packCoordinate(int x, int y) {
+    return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
+
+// Energy of one contact between residues i and j
+inline int contactEnergy(const contactIndex &hIndex, int i, int j) {
+    int typeI = hIndex.siteTypes[i];
+    int typeJ = hIndex.siteTypes[j];
+    // Residues without a type (P for the HP model, letters the model lacks) have no pair entry
+    if(typeI < 0 || typeJ < 0) {
+        return 0;
+    }
+    return hIndex.pairEnergy[typeI * hIndex.numTypes + typeJ];
+}
+
+#endif // CONTACTINDEX_H
@@ -0,0 +1,130 @@
+#include "energymodel.h"
+
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <mutex>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+
+using namespace std;
+
+
+energyModel hpEnergyModel() {
+    energyModel model;
+    model.name = "hp";
+    model.scale = 1;
+    model.alphabet = "hp";
+    model.pairEnergy = { -1, 0,
+                          0, 0 };
+    return model;
+}
+
+energyModel hpnxEnergyModel() {
+    energyModel model;
+    model.name = "hpnx";
+    model.scale = 1;
+    // Hydrophobic, positive, negative, neutral
+    model.alphabet = "hpnx";
+    model.pairEnergy = { -4,  0,  0,  0,
+                          0,  1, -1,  0,
+                          0, -1,  1,  0,
+                          0,  0,  0,  0 };
+    return model;
+}
+
+
+bool loadEnergyModel(const string &filename, energyModel &model, string &error) {
+    ifstream modelFile(filename.c_str());
+    if(!modelFile.is_open()) {
+        error = "Error opening file: " + filename + "\n" + "ERROR: " + strerror(errno);
+        return false;
+    }
+
+    model.name = filename;
+    model.scale = 1;
+    model.alphabet = "";
+    model.pairEnergy.clear();
+
+    vector<vector<double>> rows;
+    string lineInput;
+    int lineNum = 0;
+    while(getline(modelFile, lineInput)) {
+        lineNum++;
+        istringstream line(lineInput);
+        string key;
+        if(!(line >> key) || key[0] == '#') {
+            continue;
+        }
+
+        if(key == "name") {
+            line >> model.name;
+        } else if(key == "scale") {
+            line >> model.scale;
+        } else if(key == "alphabet") {
+            line >> model.alphabet;
+        } else {
+            // A matrix row: the letter, then its energies
+            if(model.alphabet.empty() || key.size() != 1 || rows.size() >= model.alphabet.size() ||
+               tolower(key[0]) != tolower(model.alphabet[rows.size()])) {
+                error = "Error in energy model " + filename + " line " + to_string(lineNum) + ": expected the row for " +
+                        (rows.size() < model.alphabet.size() ? string(1, model.alphabet[rows.size()]) : string("nothing"));
+                return false;
+            }
+            vector<double> row;
+            double energy;
+            while(line >> energy) {
+                row.push_back(energy);
+            }
+            if(row.size() != rows.size() + 1 && row.size() != model.alphabet.size()) {
+                error = "Error in energy model " + filename + " line " + to_string(lineNum) + ": wrong number of energies";
+                return false;
+            }
+            rows.push_back(row);
+        }
+    }
+
+    int numTypes = model.alphabet.size();
+    if(numTypes == 0 || (int)rows.size() != numTypes || model.scale <= 0) {
+        error = "Error in energy model " + filename + ": needs an alphabet, a positive scale and one row per letter";
+        return false;
+    }
+
+    // The matrix is symmetric, so everything comes from the lower triangle
+    model.pairEnergy.assign(numTypes * numTypes, 0);
+    for(int i=0;i<numTypes;i++) {
+        for(int j=0;j<numTypes;j++) {
+            double energy = j <= i ? rows[i][j] : rows[j][i];
+            model.pairEnergy[i*numTypes + j] = (int)lround(energy * model.scale);
+        }
+    }
+    for(int k=0;k<numTypes;k++) {
+        model.alphabet[k] = tolower(model.alphabet[k]);
+    }
+
+    return true;
+}
+
+
+const energyModel *findEnergyModel(const string &name, string &error) {
+    static mutex modelsMutex;
+    static map<string, energyModel> models;
+
+    lock_guard<mutex> lock(modelsMutex);
+    map<string, energyModel>::iterator found = models.find(name);
+    if(found != models.end()) {
+        return &found->second;
+    }
+
+    energyModel model;
+    if(name == "hp") {
+        model = hpEnergyModel();
+    } else if(name == "hpnx") {
+        model = hpnxEnergyModel();
+    } else if(!loadEnergyModel(name, model, error)) {
+        return NULL;
+    }
+
+    return &(models[name] = model);
+}
@@ -0,0 +1,48 @@
+#ifndef ENERGYMODEL_H
+#define ENERGYMODEL_H
+
+#include <string>
+#include <vector>
+
+// Contact energies between residue types on the lattice.
+//
+// Energies are kept in fixed point (the model's energy times scale, rounded)
+// so fitness stays an int and the search keeps comparing and sorting ints.
+// With the HP model (scale 1, H-H = -1) fitness is exactly what it always
+// was; for other models fitness and the target fitness in the input file
+// are in the model's scaled units.
+struct energyModel {
+    std::string name;
+    int scale;
+
+    // Residue letters, letter k is type k. Sequences are matched without case.
+    std::string alphabet;
+
+    // alphabet.size() x alphabet.size() contact energies, fixed point, symmetric
+    std::vector<int> pairEnergy;
+};
+
+// Built-in models: "hp" (H-H = -1) and "hpnx" (Backofen's H/P/N/X charges)
+energyModel hpEnergyModel();
+energyModel hpnxEnergyModel();
+
+// Reads a model file such as a 20x20 Miyazawa-Jernigan table:
+//
+//   # comment
+//   name mj1996
+//   scale 100
+//   alphabet CMFILVWYAGTSNQDEHRKP
+//   C -5.44
+//   M -4.99 -5.46
+//   ...
+//
+// One row per letter of the alphabet, in order, holding either the lower
+// triangle (row k has k+1 values) or the whole row. Energies are real
+// numbers and are multiplied by scale (default 1).
+bool loadEnergyModel(const std::string &filename, energyModel &model, std::string &error);
+
+// "hp", "hpnx" or the name of a model file. Models are loaded once and
+// shared; returns NULL and sets error if the model cannot be loaded.
+const energyModel *findEnergyModel(const std::string &name, std::string &error);
+
+#endif // ENERGYMODEL_H
@@ -0,0 +1,312 @@
+#include "fixedlength.h"
+#include "perfcounters.h"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+
+// Smallest power of two that is at least n
+static constexpr int gridSide(int n) {
+    return n <= 1 ? 1 : 2 * gridSide((n + 1) / 2);
+}
+
+// N directions move at most N cells along either axis (the crossover checks
+// walks whose terminal '0' it has overwritten with a move), so on a torus of
+// side > N two residues share a cell only if they share it on the plane
+template<int N>
+struct fixedLattice {
+    static const int side = gridSide(N + 1);
+    static const int mask = side - 1;
+
+    static int cellOf(int x, int y) {
+        return (y & mask) * side + (x & mask);
+    }
+
+    // All zero between calls, kernels reset the cells they mark
+    static array<unsigned char, side * side> &cells() {
+        static thread_local array<unsigned char, side * side> grid = {};
+        return grid;
+    }
+};
+
+static inline void stepOn(char direction, int &x, int &y) {
+    if(direction == '1') {
+        y--;
+    }
+    else if(direction == '2') {
+        x++;
+    }
+    else if(direction == '3') {
+        y++;
+    }
+    else if(direction == '4') {
+        x--;
+    }
+}
+
+// Direction turned by a quarter turns, wrapped into 1-4 the way the generic operators do it
+static inline char rotated(char direction, int by) {
+    int newDir = (int)(direction - '0') + by;
+    if(newDir > 4) {
+        newDir -= 4;
+    } else if(newDir < 1) {
+        newDir += 4;
+    }
+    return '0' + newDir;
+}
+
+template<int N>
+static array<char, N> toGenome(const string &proteinDirection) {
+    array<char, N> genome;
+    memcpy(genome.data(), proteinDirection.data(), N);
+    return genome;
+}
+
+template<int N>
+static string toString(const array<char, N> &genome) {
+    return string(genome.begin(), genome.end());
+}
+
+
+template<int N>
+static bool collides(const array<char, N> &genome) {
+    auto &cells = fixedLattice<N>::cells();
+
+    // Start cell plus one per residue, a '0' marks its cell again
+    array<int, N + 1> marked;
+    int numMarked = 0;
+
+    int currX = 0;
+    int currY = 0;
+    marked[numMarked++] = fixedLattice<N>::cellOf(currX, currY);
+    cells[marked[0]] = 1;
+
+    bool collision = false;
+    for(int i=0;i<N;i++) {
+        char currentDirection = genome[i];
+        stepOn(currentDirection, currX, currY);
+
+        int cell = fixedLattice<N>::cellOf(currX, currY);
+        if(cells[cell] == 1 && currentDirection != '0') {
+            collision = true;
+            break;
+        }
+        cells[cell] = 1;
+        marked[numMarked++] = cell;
+    }
+
+    for(int i=0;i<numMarked;i++) {
+        cells[marked[i]] = 0;
+    }
+    return collision;
+}
+
+
+template<int N>
+static int fitnessOf(const contactIndex &hIndex, const array<char, N> &genome) {
+    static_assert(N < 255, "contact slots are stored in a byte per cell");
+    const vector<int> &positions = hIndex.contactPositions;
+    if(hIndex.evenSlots.empty() || hIndex.oddSlots.empty()) {
+        return 0;
+    }
+
+    array<int, N> residueX;
+    array<int, N> residueY;
+    int currX = 0;
+    int currY = 0;
+    for(int i=0;i<N;i++) {
+        residueX[i] = currX;
+        residueY[i] = currY;
+        stepOn(genome[i], currX, currY);
+    }
+
+    // Mark the even contact residues with their slot + 1, probe around the odd ones
+    auto &cells = fixedLattice<N>::cells();
+    for(int slot : hIndex.evenSlots) {
+        int position = positions[slot];
+        cells[fixedLattice<N>::cellOf(residueX[position], residueY[position])] = slot + 1;
+    }
+
+    static const int offsetX[4] = { 0, 1, 0, -1 };
+    static const int offsetY[4] = { -1, 0, 1, 0 };
+
+    int fitness = 0;
+    for(int slot : hIndex.oddSlots) {
+        int position = positions[slot];
+        const int *energyRow = &hIndex.pairEnergy[hIndex.contactTypes[slot] * hIndex.numTypes];
+        for(int d=0;d<4;d++) {
+            int marked = cells[fixedLattice<N>::cellOf(residueX[position] + offsetX[d], residueY[position] + offsetY[d])];
+            if(marked != 0) {
+                int otherSlot = marked - 1;
+                int other = positions[otherSlot];
+                int bonded = (other - position == 1) | (position - other == 1);
+                fitness += energyRow[hIndex.contactTypes[otherSlot]] & (bonded - 1);
+            }
+        }
+    }
+
+    for(int slot : hIndex.evenSlots) {
+        int position = positions[slot];
+        cells[fixedLattice<N>::cellOf(residueX[position], residueY[position])] = 0;
+    }
+    return fitness;
+}
+
+
+// The operators count their checks like the generic ones, the entry points
+// below are already counted by the generic function that dispatched them
+template<int N>
+static bool probedCollides(const array<char, N> &genome) {
+    KernelProbe probe(kernelCollision);
+    return collides<N>(genome);
+}
+
+template<int N>
+static int probedFitness(const contactIndex &hIndex, const array<char, N> &genome) {
+    KernelProbe probe(kernelFitness);
+    return fitnessOf<N>(hIndex, genome);
+}
+
+
+// Same draws and rotations as the generic mutate in folding.cpp
+template<int N>
+static string mutateFixed(const string &proteinDirection, int numToTry) {
+    const array<char, N> original = toGenome<N>(proteinDirection);
+
+    for(int i=0;i<numToTry;i++) {
+        array<char, N> testProteinDir = original;
+        int randomIndex = foldRand() % (N - 1);
+
+        char randomDir = '0' + ((foldRand() % 4) + 1);
+        while(testProteinDir[randomIndex] == randomDir) {
+            randomDir = '0' + ((foldRand() % 4) + 1);
+        }
+
+        int offset = abs((int)randomDir - (int)testProteinDir[randomIndex]);
+        int twistDirection = foldRand() % 2;
+        int sweepDirection = foldRand() % 2;
+
+        int twist = twistDirection == 0 ? -offset : offset;
+        if(sweepDirection == 0) {
+            for(int k=randomIndex;k>=0;k--) {
+                testProteinDir[k] = rotated(testProteinDir[k], twist);
+            }
+        } else {
+            for(int k=randomIndex;k<N-1;k++) {
+                if(testProteinDir[k] != '0') {
+                    testProteinDir[k] = rotated(testProteinDir[k], twist);
+                }
+            }
+        }
+
+        if(!probedCollides<N>(testProteinDir)) {
+            return toString<N>(testProteinDir);
+        }
+    }
+    return "failed";
+}
+
+
+// Same draws and rotations as the generic crossover in folding.cpp
+template<int N>
+static proteinNode crossoverFixed(const proteinNode &parent1, const proteinNode &parent2, int numToTry, const contactIndex &hIndex) {
+    const array<char, N> genome1 = toGenome<N>(parent1.proteinDirection);
+    const array<char, N> genome2 = toGenome<N>(parent2.proteinDirection);
+
+    proteinNode child;
+    for(int i=0;i<numToTry;i++) {
+        int randIndexL = foldRand() % N;
+        int randIndexH = foldRand() % N;
+        while(randIndexL == randIndexH) {
+            randIndexL = foldRand() % N;
+            randIndexH = foldRand() % N;
+        }
+
+        if(randIndexL > randIndexH) {
+            int temp = randIndexL;
+            randIndexL = randIndexH;
+            randIndexH = temp;
+        }
+
+        int sweepDirection = foldRand() % 2;
+        int twistDirection = foldRand() % 2;
+
+        // Sweeping down copies [L, H] and keeps parent1's fitness, sweeping
+        // up copies [L, H) and rescores the child, as the generic code does
+        int first = randIndexL;
+        int last = sweepDirection == 0 ? randIndexH : randIndexH - 1;
+        for(int j=0;j<4;j++) {
+            array<char, N> childDir = genome1;
+            int twist = twistDirection == 1 ? j : -j;
+            for(int k=first;k<=last;k++) {
+                childDir[k] = rotated(genome2[k], twist);
+            }
+
+            if(!probedCollides<N>(childDir)) {
+                child.proteinDirection = toString<N>(childDir);
+                if(sweepDirection == 0) {
+                    child.fitness = parent1.fitness;
+                } else if(hIndex.length == N) {
+                    child.fitness = probedFitness<N>(hIndex, childDir);
+                } else {
+                    child.fitness = getFitnessRating(hIndex, child.proteinDirection);
+                }
+                return child;
+            }
+        }
+    }
+
+    child.proteinDirection = "failed";
+    child.fitness = 0;
+    return child;
+}
+
+
+template<int N>
+static bool collisionEntry(const string &proteinDirection) {
+    return collides<N>(toGenome<N>(proteinDirection));
+}
+
+template<int N>
+static int fitnessEntry(const contactIndex &hIndex, const string &proteinDirection) {
+    return fitnessOf<N>(hIndex, toGenome<N>(proteinDirection));
+}
+
+template<int N>
+struct fixedLength {
+    static const fixedLengthKernels kernels;
+};
+
+template<int N>
+const fixedLengthKernels fixedLength<N>::kernels = {
+    N,
+    collisionEntry<N>,
+    fitnessEntry<N>,
+    mutateFixed<N>,
+    crossoverFixed<N>
+};
+
+
+const fixedLengthKernels *findFixedKernels(int length) {
+#ifdef FOLDING_NO_FIXED_LENGTH
+    (void)length;
+    return nullptr;
+#else
+    switch(length) {
+    case 20: return &fixedLength<20>::kernels;
+    case 24: return &fixedLength<24>::kernels;
+    case 25: return &fixedLength<25>::kernels;
+    case 36: return &fixedLength<36>::kernels;
+    case 48: return &fixedLength<48>::kernels;
+    case 50: return &fixedLength<50>::kernels;
+    case 60: return &fixedLength<60>::kernels;
+    case 64: return &fixedLength<64>::kernels;
+    case 85: return &fixedLength<85>::kernels;
+    case 100: return &fixedLength<100>::kernels;
+    default: return nullptr;
+    }
+#endif
+}
@@ -0,0 +1,37 @@
+#ifndef FIXEDLENGTH_H
+#define FIXEDLENGTH_H
+
+#include <string>
+
+#include "folding.h"
+
+// Operators and scoring compiled for one chain length.
+//
+// The generic kernels take the chain length from the string they are handed,
+// and collisionDetection builds a fresh grid of vectors on every call. For the
+// lengths of the standard HP benchmarks (20, 24, 25, 36, 48, 50, 60, 64, 85
+// and 100) the kernels are also instantiated with the length as a template
+// argument: genomes are std::array copies, every walk has a constant trip
+// count, and the lattice is a per-thread torus of side the next power of two
+// of the length, which a walk of that length cannot wrap around on. The torus
+// is cleared after each walk by resetting only the cells it marked.
+//
+// mutate, crossover, collisionDetection and getFitnessRating look up the
+// kernels for their input's length and fall back to the generic code for any
+// other length. The fixed kernels draw the same random numbers in the same
+// order, so a seeded run takes the same path either way.
+//
+// Build with qmake "CONFIG += genericlength" to always take the generic path.
+struct fixedLengthKernels {
+    int length;
+
+    bool (*collisionDetection)(const std::string &proteinDirection);
+    int (*getFitnessRating)(const contactIndex &hIndex, const std::string &proteinDirection);
+    std::string (*mutate)(const std::string &proteinDirection, int numToTry);
+    proteinNode (*crossover)(const proteinNode &parent1, const proteinNode &parent2, int numToTry, const contactIndex &hIndex);
+};
+
+// Kernels for chains of this length, or null if there are none
+const fixedLengthKernels *findFixedKernels(int length);
+
+#endif // FIXEDLENGTH_H
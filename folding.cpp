@@ -0,0 +1,404 @@
+#include "folding.h"
+#include "fixedlength.h"
+#include "perfcounters.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstdint>
+
+using namespace std;
+
+
+// Seeds handed to threads as they draw their first number
+static atomic<uint64_t> seedBase(0x853c49e6748fea9bULL);
+
+struct foldRandState {
+    uint64_t state;
+    bool seeded;
+};
+
+static thread_local foldRandState randState = { 0, false };
+
+static inline uint64_t splitMix(uint64_t &x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+int foldRand() {
+    if(!randState.seeded) {
+        uint64_t base = seedBase.fetch_add(0x9e3779b97f4a7c15ULL);
+        randState.state = splitMix(base);
+        randState.seeded = true;
+    }
+
+    // xorshift64*
+    uint64_t x = randState.state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    randState.state = x;
+    return (int)((x * 0x2545f4914f6cdd1dULL) >> 33);
+}
+
+void seedFoldRand(unsigned int seed) {
+    // Only this thread's state, other threads drawing from seedBase meanwhile must not shift it
+    uint64_t base = seed;
+    randState.state = splitMix(base);
+    randState.seeded = true;
+}
+
+void seedFoldRandBase(unsigned int seed) {
+    uint64_t base = seed;
+    seedBase = splitMix(base);
+}
+
+
+// Tries numToTry times to mutate a random index of the proteinDirection string
+string mutate(string proteinDirection, int numToTry, int maxFitnessLimit) {
+    KernelProbe probe(kernelMutate);
+    if(const fixedLengthKernels *fixed = findFixedKernels(proteinDirection.size())) {
+        return fixed->mutate(proteinDirection, numToTry);
+    }
+
+    for(int i=0;i<numToTry;i++) {
+        // Reset string, generate random index
+        string testProteinDir = proteinDirection;
+        int randomIndex = foldRand() % (proteinDirection.size() - 1);
+        char charAtIndex = testProteinDir[randomIndex];
+
+        char randomDir = '0' + ((foldRand() % 4) + 1);
+
+        // Make sure the direction is not the same
+        while(testProteinDir[randomIndex] == randomDir) {
+            randomDir = '0' + ((foldRand() % 4) + 1);
+        }
+
+        // Calculate offset between original and new directions
+        int offset = abs((int)randomDir - (int)testProteinDir[randomIndex]);
+        // Generate twistDirection for mutation twist, and sweep direction for direction of sweep
+        // For both, 0 is left and 1 is right
+        int twistDirection = foldRand() % 2;
+        int sweepDirection = foldRand() % 2;
+
+        // Do loop to perform mutation of each index after or before the
+        if(sweepDirection == 0) {
+            // Go to the left
+            for(int i=randomIndex;i>=0;i--) {
+                if(twistDirection == 0) {
+                    // Calculate new dir and make sure it is valid
+                    int newDir = (int)(testProteinDir[i] - '0') - offset;
+                    if(newDir < 1) {
+                        newDir += 4;
+                    }
+                    testProteinDir[i] = '0' + newDir;
+                } else {
+                    int newDir = (int)(testProteinDir[i] - '0') + offset;
+                    if(newDir > 4) {
+                        newDir -= 4;
+                    }
+                    testProteinDir[i] = '0' + newDir;
+                }
+            }
+        } else {
+            // Go to the right
+            // Note, does not check last index (should remain 0)
+            for(int i=randomIndex;i<proteinDirection.size()-1;i++) {
+                if(testProteinDir[i] != '0') {
+                    if(twistDirection == 0) {
+                        // Calculate new dir and make sure it is valid
+                        int newDir = (int)(testProteinDir[i] - '0') - offset;
+                        if(newDir < 1) {
+                            newDir += 4;
+                        }
+                        testProteinDir[i] = '0' + newDir;
+                    } else {
+                        int newDir = (int)(testProteinDir[i] - '0') + offset;
+                        if(newDir > 4) {
+                            newDir -= 4;
+                        }
+                        testProteinDir[i] = '0' + newDir;
+                    }
+                }
+            }
+        }
+
+        // If the mutation is successful, return it
+        if(!collisionDetection(testProteinDir, maxFitnessLimit)) {
+            return testProteinDir;
+        }
+    }
+    // If the numToTry runs out, return failed
+    return "failed";
+}
+
+
+
+
+vector<proteinNode> generateInitialPop(int amount, int length, int maxFitnessLimit) {
+    vector<proteinNode> population;
+
+    for(int i=0;i<amount;i++) {
+        proteinNode tempNode;
+        population.push_back(tempNode);
+        string sequence = createRandomSequence(length, maxFitnessLimit);
+        population[i].proteinDirection = sequence;
+    }
+    return population;
+}
+
+
+// Grabs a parent using a weighted selection method
+proteinNode grabParent(vector<proteinNode> population, int numElite) {
+    KernelProbe probe(kernelGrabParent);
+    int divBy = 8;
+    int chance = (foldRand() % divBy) + 1;
+
+    int toGrab = -1;
+    // 25% Chance
+    int tempChance = numElite * divBy;
+
+    int randomChance = foldRand() % tempChance;
+    if(randomChance < tempChance/chance) {
+        toGrab = randomChance;
+    } else {
+        toGrab = tempChance/chance + foldRand() % (population.size() - tempChance/2);
+    }
+
+    return population[toGrab];
+}
+
+
+// Crosses 2 proteins over, if they can be crossed. Otherwise, returns "failed" in the proteinDirection
+proteinNode crossover(proteinNode parent1, proteinNode parent2, int numToTry, int maxFitnessLimit, const contactIndex &hIndex) {
+    KernelProbe probe(kernelCrossover);
+    int sizeParents = parent1.proteinDirection.size();
+    if((int)parent2.proteinDirection.size() == sizeParents) {
+        if(const fixedLengthKernels *fixed = findFixedKernels(sizeParents)) {
+            return fixed->crossover(parent1, parent2, numToTry, hIndex);
+        }
+    }
+
+    proteinNode parent1Mod;
+    proteinNode parent2Mod;
+
+    proteinNode child;
+
+    // Loops for number of attempts allowed with these 2 proteinNodes
+    for(int i=0;i<numToTry;i++) {
+        parent1Mod = parent1;
+        parent2Mod = parent2;
+
+        // Index to start and end, direction to go in string, direction to twist when rotate checking
+        int randIndexL = foldRand() % sizeParents;
+        int randIndexH = foldRand() % sizeParents;
+        while(randIndexL == randIndexH) {
+            randIndexL = foldRand() % sizeParents;
+            randIndexH = foldRand() % sizeParents;
+        }
+
+        if(randIndexL > randIndexH) {
+            int temp = randIndexL;
+            randIndexL = randIndexH;
+            randIndexH = temp;
+        }
+
+
+        int sweepDirection = foldRand() % 2;
+        int twistDirection = foldRand() % 2;
+
+        if(sweepDirection == 0) {
+            for(int j=0;j<4;j++) {
+                for(int k=randIndexH;k>=randIndexL;k--) {
+                    // Modify the value based on the random twistDirection chosen
+                    int tempDirection;
+                    if(twistDirection == 1) {
+                        tempDirection = (int)(parent2Mod.proteinDirection[k]) + j - 48;
+                    } else {
+                        tempDirection = (int)(parent2Mod.proteinDirection[k]) - j - 48;
+                    }
+
+                    // Account for numbers outside the range
+                    if (tempDirection > 4) {
+                        tempDirection -= 4;
+                    } else if (tempDirection < 1) {
+                        tempDirection += 4;
+                    }
+
+                    parent1Mod.proteinDirection[k] = '0' + tempDirection;
+                }
+
+                if(!collisionDetection(parent1Mod.proteinDirection, maxFitnessLimit)) {
+                    return parent1Mod;
+                }
+
+                parent1Mod = parent1;
+                parent2Mod = parent2;
+            }
+        } else {
+            for(int j=0;j<4;j++) {
+                for(int k=randIndexL;k<randIndexH;k++) {
+                    int tempDirection;
+                    if(twistDirection == 1) {
+                        tempDirection = (int)(parent2Mod.proteinDirection[k]) + j - 48;
+                    } else {
+                        tempDirection = (int)(parent2Mod.proteinDirection[k]) - j - 48;
+                    }
+
+                    if (tempDirection > 4) {
+                        tempDirection -= 4;
+                    } else if (tempDirection < 1) {
+                        tempDirection += 4;
+                    }
+
+                    parent1Mod.proteinDirection[k] = '0' + tempDirection;
+                }
+
+                if(!collisionDetection(parent1Mod.proteinDirection, maxFitnessLimit)) {
+                    parent1Mod.fitness = getFitnessRating(hIndex, parent1Mod.proteinDirection);
+                    return parent1Mod;
+                }
+
+                parent1Mod = parent1;
+                parent2Mod = parent2;
+            }
+        }
+    }
+
+    child.proteinDirection = "failed";
+    child.fitness = 0;
+    return child;
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+// Generate random valid structure
+string createRandomSequence(int length, int maxFitnessLimit) {
+    KernelProbe probe(kernelRandomFold);
+    string randomSequence;
+
+    // While the directional sequence isn't valid, keep generating until a valid one is produced
+    bool valid = false;
+    while(!valid) {
+        vector<vector<int>> collisionTestMap(maxFitnessLimit*2+3, vector<int>(maxFitnessLimit*2+3, 0));
+        int currX = maxFitnessLimit + 1;
+        int currY = maxFitnessLimit + 1;
+
+        // Mark starting point
+        collisionTestMap[currX][currY] = 1;
+
+        for(int i=0;i<length;i++) {
+            int currentDirection;
+
+            // Check if last, if so use a 0 instead of 1-4
+            if(i == length-1) {
+                randomSequence.append(to_string(0));
+            } else {
+                // 1,2,3,4
+                currentDirection = (foldRand() % 4) + 1;
+
+                // Check if collision & randomly go clock or counter clockwise for directions
+                // 0=Clockwise, 1=Counter
+                int searchDirection = foldRand() % 2;
+                for(int j=0;j<3;j++) {
+                    if(currentDirection == 1 && collisionTestMap[currX][currY-1] != 1) {
+                        currY--;
+                        break;
+                    }
+                    else if(currentDirection == 2 && collisionTestMap[currX+1][currY] != 1) {
+                        currX++;
+                        break;
+                    }
+                    else if(currentDirection == 3 && collisionTestMap[currX][currY+1] != 1) {
+                        currY++;
+                        break;
+                    }
+                    else if(currentDirection == 4 && collisionTestMap[currX-1][currY] != 1) {
+                        currX--;
+                        break;
+                    } else {
+                        if(searchDirection == 0) {
+                            currentDirection++;
+                        } else {
+                            currentDirection--;
+                        }
+
+                        if(currentDirection > 4) {
+                            currentDirection = 1;
+                        } else if(currentDirection < 1) {
+                            currentDirection = 4;
+                        }
+                    }
+                }
+                // Mark cell and append string
+                collisionTestMap[currX][currY] = 1;
+                randomSequence.append(to_string(currentDirection));
+            }
+        }
+        if(!collisionDetection(randomSequence, maxFitnessLimit)) {
+            valid = true;
+        } else {
+            randomSequence = "";
+        }
+    }
+
+    return randomSequence;
+}
+
+
+// Detects if a protein's path intersects itself. If it does, return true.
+bool collisionDetection(string proteinDirection, int maxFitnessLimit) {
+    KernelProbe probe(kernelCollision);
+    if(const fixedLengthKernels *fixed = findFixedKernels(proteinDirection.size())) {
+        return fixed->collisionDetection(proteinDirection);
+    }
+    // Initialized to zero, used for detecting collisions when combining proteins.
+    vector<vector<int>> collisionTestMap(maxFitnessLimit*2+3, vector<int>(maxFitnessLimit*2+3, 0));
+    int currX = maxFitnessLimit + 1;
+    int currY = maxFitnessLimit + 1;
+
+    // Mark starting point
+    collisionTestMap[currX][currY] = 1;
+
+    for(int i=0;i<proteinDirection.size();i++) {
+
+        char currentDirection = proteinDirection[i];
+
+        if(currentDirection == '1') {
+            currY -= 1;
+        }
+        else if(currentDirection == '2') {
+            currX += 1;
+        }
+        else if(currentDirection == '3') {
+            currY += 1;
+        }
+        else if(currentDirection == '4') {
+            currX -= 1;
+        }
+
+        // Check if cell is marked. If it is collision return true, if not mark cell
+        if(collisionTestMap[currX][currY] == 1 && currentDirection != '0') {
+            return true;
+        } else {
+            collisionTestMap[currX][currY] = 1;
+        }
+    }
+
+    return false;
+}
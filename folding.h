@@ -0,0 +1,41 @@
+#ifndef FOLDING_H
+#define FOLDING_H
+
+#include <string>
+#include <vector>
+
+#include "contactindex.h"
+
+// Created these for easier sorting purposes
+struct proteinNode {
+    std::string proteinDirection;
+    int fitness;
+};
+// Test for order
+struct ascending {
+    bool operator()(proteinNode const &a, proteinNode const &b) {
+        return a.fitness < b.fitness;
+    }
+};
+
+
+// Random numbers for the operators. Each thread has its own generator so
+// engines running side by side do not fight over the lock inside rand().
+// Returns a value in [0, 2^31).
+int foldRand();
+// Reseeds the calling thread only, so a seed gives the same numbers whatever other threads draw
+void seedFoldRand(unsigned int seed);
+// Sets what threads that have not drawn yet derive their seeds from, for process startup
+void seedFoldRandBase(unsigned int seed);
+
+
+// Constructors
+std::string mutate(std::string, int, int);
+std::vector<proteinNode> generateInitialPop(int, int, int);
+proteinNode grabParent(std::vector<proteinNode>, int); // For weighted selection
+proteinNode crossover(proteinNode, proteinNode, int, int, const contactIndex &);
+std::string createRandomSequence(int, int);
+
+bool collisionDetection(std::string, int);
+
+#endif // FOLDING_H
@@ -0,0 +1,63 @@
+# Folding core: encoding, evaluation, operators and the search engines.
+# Qt-free, shared by the application and the libfolding library target.
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += $$PWD/sequencestream.cpp\
+        $$PWD/perfcounters.cpp\
+        $$PWD/memorybudget.cpp\
+        $$PWD/energymodel.cpp\
+        $$PWD/contactindex.cpp\
+        $$PWD/folding.cpp\
+        $$PWD/workerpool.cpp\
+        $$PWD/fixedlength.cpp\
+        $$PWD/niching.cpp\
+        $$PWD/operatorcontrol.cpp\
+        $$PWD/restartscheduler.cpp\
+        $$PWD/foldingengine.cpp\
+        $$PWD/replicaexchange.cpp\
+        $$PWD/steadystate.cpp\
+        $$PWD/sawtree.cpp\
+        $$PWD/pivotengine.cpp\
+        $$PWD/localsearch.cpp\
+        $$PWD/wanglandau.cpp\
+        $$PWD/antcolony.cpp\
+        $$PWD/resultstore.cpp\
+        $$PWD/tuner.cpp\
+        $$PWD/foldingapi.cpp
+
+HEADERS += $$PWD/sequencestream.h\
+        $$PWD/perfcounters.h\
+        $$PWD/memorybudget.h\
+        $$PWD/energymodel.h\
+        $$PWD/contactindex.h\
+        $$PWD/folding.h\
+        $$PWD/workerpool.h\
+        $$PWD/fixedlength.h\
+        $$PWD/niching.h\
+        $$PWD/operatorcontrol.h\
+        $$PWD/restartscheduler.h\
+        $$PWD/foldingengine.h\
+        $$PWD/replicaexchange.h\
+        $$PWD/steadystate.h\
+        $$PWD/sawtree.h\
+        $$PWD/pivotengine.h\
+        $$PWD/localsearch.h\
+        $$PWD/wanglandau.h\
+        $$PWD/antcolony.h\
+        $$PWD/resultstore.h\
+        $$PWD/tuner.h\
+        $$PWD/foldingapi.h
+
+CONFIG += c++14 thread
+
+# Diagnostic build that counts every allocation: qmake "CONFIG += alloctrack"
+alloctrack {
+    DEFINES += FOLDING_TRACK_ALLOCATIONS
+}
+
+# Operators and scoring without the fixed-length kernels: qmake "CONFIG += genericlength"
+genericlength {
+    DEFINES += FOLDING_NO_FIXED_LENGTH
+}
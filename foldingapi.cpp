@@ -0,0 +1,171 @@
+#include "foldingapi.h"
+
+#include "folding.h"
+#include "foldingengine.h"
+#include "memorybudget.h"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include <ctime>
+
+using namespace std;
+
+
+void foldDefaultOptions(foldOptions *options) {
+    foldingOptions defaults;
+
+    options->popNum = defaults.popNum;
+    options->elitePercentage = defaults.elitePercentage;
+    options->mutatePercentage = defaults.mutatePercentage;
+    options->crossoverPercentage = defaults.crossoverPercentage;
+    options->numToTry = defaults.numToTry;
+    options->maxFitnessLimit = defaults.maxFitnessLimit;
+    options->engine = NULL;
+    options->maxGenerations = 0;
+    options->maxSeconds = 0;
+    options->numThreads = 0;
+    options->seed = 0;
+    options->energyModel = NULL;
+}
+
+
+// Folds one sequence until its target or budget, writing into the caller's slots
+static void foldOne(const string &proteinSequence, int targetFitness, const string &engineName, const foldingOptions &searchOptions,
+                    const foldOptions &options, char *direction, int *energy, long *generation) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    unique_ptr<FoldingEngine> engine = createEngine(engineName, proteinSequence, targetFitness, searchOptions);
+    while(!engine->isSolved()) {
+        engine->step();
+
+        if(options.maxGenerations > 0 && engine->generation() >= options.maxGenerations) {
+            break;
+        }
+        if(options.maxSeconds > 0 && chrono::duration<double>(chrono::steady_clock::now() - start).count() >= options.maxSeconds) {
+            break;
+        }
+    }
+
+    const proteinNode &best = engine->best();
+    memcpy(direction, best.proteinDirection.c_str(), best.proteinDirection.size() + 1);
+    *energy = best.fitness;
+    if(generation != NULL) {
+        *generation = engine->generation();
+    }
+}
+
+
+int foldBatch(const char *const *sequences, const int *targetFitness, int count, const foldOptions *options,
+              char *directions, size_t directionStride, int *energies, long *generations) {
+    if(sequences == NULL || options == NULL || directions == NULL || energies == NULL || count < 0) {
+        return FOLD_ERROR_ARGUMENT;
+    }
+
+    string engineName = options->engine != NULL ? options->engine : "ga";
+    if(!hasEngine(engineName)) {
+        return FOLD_ERROR_ENGINE;
+    }
+
+    // The GA indexes population[numElite-1] and draws % popNum, so both must be at least one
+    int numElite = (options->elitePercentage/100.0) * options->popNum;
+    if(options->popNum < 1 || numElite < 1 || options->elitePercentage > 100 || options->numToTry < 1 ||
+       options->mutatePercentage < 0 || options->mutatePercentage > 100 ||
+       options->crossoverPercentage < 0 || options->crossoverPercentage > 100) {
+        return FOLD_ERROR_OPTIONS;
+    }
+
+    foldingOptions searchOptions;
+    if(options->energyModel != NULL) {
+        string modelError;
+        if(findEnergyModel(options->energyModel, modelError) == NULL) {
+            return FOLD_ERROR_MODEL;
+        }
+        searchOptions.energyModel = options->energyModel;
+    }
+    searchOptions.popNum = options->popNum;
+    searchOptions.elitePercentage = options->elitePercentage;
+    searchOptions.mutatePercentage = options->mutatePercentage;
+    searchOptions.crossoverPercentage = options->crossoverPercentage;
+    searchOptions.numToTry = options->numToTry;
+    searchOptions.maxFitnessLimit = options->maxFitnessLimit;
+
+    // Check everything up front so a bad entry does not leave a half-filled batch
+    vector<string> proteinSequences(count);
+    vector<int> targets(count, INT_MIN);
+    bool hasBudget = options->maxGenerations > 0 || options->maxSeconds > 0;
+    for(int i=0;i<count;i++) {
+        if(sequences[i] == NULL) {
+            return FOLD_ERROR_ARGUMENT;
+        }
+
+        string &proteinSequence = proteinSequences[i];
+        proteinSequence = sequences[i];
+        for(size_t j=0;j<proteinSequence.size();j++) {
+            if(proteinSequence[j] >= 'A' && proteinSequence[j] <= 'Z') {
+                proteinSequence[j] = proteinSequence[j] - 'A' + 'a';
+            }
+        }
+        if(proteinSequence.size() < 3) {
+            return FOLD_ERROR_ARGUMENT;
+        }
+        // The random folds are laid out on a grid maxFitnessLimit cells from the middle
+        if(options->maxFitnessLimit < 1 || proteinSequence.size() > (size_t)options->maxFitnessLimit) {
+            return FOLD_ERROR_OPTIONS;
+        }
+        if(proteinSequence.size() + 1 > directionStride) {
+            return FOLD_ERROR_BUFFER;
+        }
+
+        // Same as the input file, a target of 0 or higher runs until the budget is spent
+        if(targetFitness != NULL && targetFitness[i] < 0) {
+            targets[i] = targetFitness[i];
+        } else if(!hasBudget) {
+            return FOLD_ERROR_NO_BUDGET;
+        }
+    }
+
+    int numThreads = options->numThreads;
+    if(numThreads <= 0) {
+        numThreads = thread::hardware_concurrency();
+    }
+    numThreads = max(1, min(numThreads, count));
+    searchOptions.engineThreads = engineThreadsEach(numThreads);
+
+    unsigned int seed = options->seed != 0 ? options->seed : (unsigned int)time(NULL);
+
+    // Threads take the next unclaimed sequence until the batch is done
+    atomic<int> nextSequence(0);
+    auto worker = [&]() {
+        int i;
+        while((i = nextSequence++) < count) {
+            seedFoldRand(seed + i);
+            size_t jobBytes = estimateSearchBytes(engineName, proteinSequences[i].size(), searchOptions);
+            memoryGate().acquire(jobBytes);
+            foldOne(proteinSequences[i], targets[i], engineName, searchOptions, *options,
+                    directions + i * directionStride, &energies[i], generations != NULL ? &generations[i] : NULL);
+            memoryGate().release(jobBytes);
+        }
+    };
+
+    vector<thread> workers;
+    for(int t=1;t<numThreads;t++) {
+        workers.push_back(thread(worker));
+    }
+    worker();
+    for(size_t t=0;t<workers.size();t++) {
+        workers[t].join();
+    }
+
+    return FOLD_OK;
+}
+
+
+void foldSetMemoryBudget(long megabytes) {
+    memoryGate().setBudget(megabytes > 0 ? (uint64_t)megabytes << 20 : 0);
+}
@@ -0,0 +1,87 @@
+#ifndef FOLDINGAPI_H
+#define FOLDINGAPI_H
+
+/*
+ * Batch interface of the folding library (libfolding), usable from C and C++.
+ *
+ * Link against libfolding (see libfolding.pro) and call foldBatch with any
+ * number of sequences. Everything runs inside the calling process on a pool
+ * of threads that lives for the duration of the call; no Qt, no files.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum foldStatus {
+    FOLD_OK = 0,
+    FOLD_ERROR_ARGUMENT = -1,   /* NULL pointer, count < 0 or a sequence shorter than 3 */
+    FOLD_ERROR_ENGINE = -2,     /* engine name not known */
+    FOLD_ERROR_BUFFER = -3,     /* directionStride too small for one of the sequences */
+    FOLD_ERROR_NO_BUDGET = -4,  /* no generations/seconds budget and no reachable target */
+    FOLD_ERROR_OPTIONS = -5,    /* popNum < 1, fewer than one elite, numToTry < 1, a percentage outside 0-100,
+                                   or a sequence longer than maxFitnessLimit */
+    FOLD_ERROR_MODEL = -6       /* energy model not known and not a readable model file */
+};
+
+typedef struct foldOptions {
+    /* Search options, same meaning as in Options.txt */
+    int popNum;
+    int elitePercentage;
+    int mutatePercentage;
+    int crossoverPercentage;
+    int numToTry;
+    int maxFitnessLimit;
+
+    /* Engine name ("ga", "replica", "steady", "pivot", "wanglandau", "aco"), NULL for "ga" */
+    const char *engine;
+
+    /* Per-sequence budgets, 0 for none. A sequence stops at its target fitness or its first spent budget. */
+    long maxGenerations;
+    double maxSeconds;
+
+    /* Worker threads, 0 for one per core */
+    int numThreads;
+
+    /* Seed for reproducible runs (each sequence i is seeded with seed + i), 0 for a time based seed */
+    unsigned int seed;
+
+    /* Contact energies: "hp", "hpnx" or an energy model file, NULL for "hp".
+       Energies and targets are then in the model's fixed-point units. */
+    const char *energyModel;
+} foldOptions;
+
+/* Fills options with the same defaults the application uses */
+void foldDefaultOptions(foldOptions *options);
+
+/*
+ * Folds count sequences ("hphpph...", case insensitive).
+ *
+ * targetFitness may be NULL; otherwise sequence i stops once its fitness is
+ * at or below targetFitness[i] (a target of 0 or higher is ignored).
+ *
+ * Results go into caller-provided buffers:
+ *   directions   count * directionStride bytes; the best directional sequence
+ *                of sequence i is written null-terminated at i * directionStride,
+ *                so the stride must be at least the longest sequence + 1
+ *   energies     count ints, best fitness of each sequence
+ *   generations  count longs with the generations run, may be NULL
+ *
+ * Returns FOLD_OK or one of the foldStatus errors, in which case nothing is folded.
+ */
+int foldBatch(const char *const *sequences, const int *targetFitness, int count, const foldOptions *options,
+              char *directions, size_t directionStride, int *energies, long *generations);
+
+/*
+ * Caps the memory of all searches in the process at megabytes (0 for no cap).
+ * Batches then fold fewer sequences at once instead of running out of memory.
+ */
+void foldSetMemoryBudget(long megabytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FOLDINGAPI_H */
@@ -0,0 +1,577 @@
+#include "foldingdaemon.h"
+#include "memorybudget.h"
+#include "energymodel.h"
+
+#include <vector>
+#include <queue>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <cctype>
+#include <csignal>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+// How long a job keeps a worker before it goes back in the queue
+static const double sliceSeconds = 0.05;
+
+// Longest request line, a client that sends more without a newline is dropped
+static const size_t maxLineBytes = 4 << 20;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void handleStopSignal(int) {
+    stopRequested = 1;
+}
+
+
+// One connected client. Workers write to it, the poll loop reads from it.
+// The socket is closed when the last job holding the connection lets go.
+struct clientConnection {
+    int fd;
+    bool closed;
+    mutex writeLock;
+    string readBuffer;
+
+    clientConnection(int fd) : fd(fd), closed(false) {}
+    ~clientConnection() {
+        ::close(fd);
+    }
+
+    void send(const string &line) {
+        lock_guard<mutex> guard(writeLock);
+        if(closed) {
+            return;
+        }
+
+        string message = line + "\n";
+        size_t sent = 0;
+        while(sent < message.size()) {
+            ssize_t numBytes = ::send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+            if(numBytes < 0 && errno == EINTR) {
+                continue;
+            }
+            if(numBytes <= 0) {
+                closed = true;
+                return;
+            }
+            sent += numBytes;
+        }
+    }
+
+    bool isClosed() {
+        lock_guard<mutex> guard(writeLock);
+        return closed;
+    }
+
+    void disconnect() {
+        lock_guard<mutex> guard(writeLock);
+        closed = true;
+        shutdown(fd, SHUT_RDWR);
+    }
+};
+
+
+struct foldJob {
+    long id;
+    long order;
+    string tag;
+    shared_ptr<clientConnection> client;
+
+    string proteinSequence;
+    string engineName;
+    int targetFitness;
+    int priority;
+
+    // Budgets, 0 for none
+    long maxGenerations;
+    double maxSeconds;
+
+    unique_ptr<FoldingEngine> engine;
+    // Held against the memory budget while the engine exists
+    size_t reservedBytes;
+    double cpuSeconds;
+    int lastReported;
+    bool cancelled;
+};
+
+// Higher priority first, then the job that has had the least time, then FIFO
+struct jobOrder {
+    bool operator()(const shared_ptr<foldJob> &a, const shared_ptr<foldJob> &b) const {
+        if(a->priority != b->priority) {
+            return a->priority < b->priority;
+        }
+        if(a->cpuSeconds != b->cpuSeconds) {
+            return a->cpuSeconds > b->cpuSeconds;
+        }
+        return a->order > b->order;
+    }
+};
+
+
+class FoldingDaemon
+{
+public:
+    FoldingDaemon(const foldingOptions &defaults, int numWorkers);
+
+    int run(const string &socketPath);
+
+private:
+    void workerLoop();
+    void runSlice(const shared_ptr<foldJob> &job);
+    void finishJob(const shared_ptr<foldJob> &job, const string &reason);
+    void requeueDeferred();
+
+    void handleLine(const shared_ptr<clientConnection> &client, const string &line);
+    void submitJob(const shared_ptr<clientConnection> &client, const vector<string> &tokens);
+
+    foldingOptions defaults;
+    int numWorkers;
+
+    mutex queueLock;
+    condition_variable queueReady;
+    priority_queue<shared_ptr<foldJob>, vector<shared_ptr<foldJob>>, jobOrder> queue;
+    // Every job not yet finished, for cancel
+    map<long, shared_ptr<foldJob>> activeJobs;
+    // Jobs that did not fit in the memory budget, they go back in the queue when a job finishes
+    vector<shared_ptr<foldJob>> deferred;
+    int numRunning;
+    long nextJobId;
+    long nextOrder;
+    bool stopping;
+};
+
+
+FoldingDaemon::FoldingDaemon(const foldingOptions &defaults, int numWorkers) :
+    defaults(defaults),
+    numWorkers(numWorkers),
+    numRunning(0),
+    nextJobId(1),
+    nextOrder(0),
+    stopping(false)
+{
+    if(this->numWorkers <= 0) {
+        this->numWorkers = max(1u, thread::hardware_concurrency());
+    }
+    if(this->defaults.engineThreads <= 0) {
+        this->defaults.engineThreads = engineThreadsEach(this->numWorkers);
+    }
+}
+
+
+int FoldingDaemon::run(const string &socketPath) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(socketPath.size() >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socketPath.c_str());
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenFd < 0) {
+        fprintf(stderr, "Error creating socket\nERROR: %s\n", strerror(errno));
+        return 1;
+    }
+
+    // A stale socket from a previous run would make bind fail
+    unlink(socketPath.c_str());
+    if(bind(listenFd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(listenFd, 64) < 0) {
+        fprintf(stderr, "Error listening on %s\nERROR: %s\n", socketPath.c_str(), strerror(errno));
+        ::close(listenFd);
+        return 1;
+    }
+
+    signal(SIGINT, handleStopSignal);
+    signal(SIGTERM, handleStopSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    vector<thread> workers;
+    for(int i=0;i<numWorkers;i++) {
+        workers.push_back(thread(&FoldingDaemon::workerLoop, this));
+    }
+
+    fprintf(stderr, "Folding daemon listening on %s with %d workers\n", socketPath.c_str(), numWorkers);
+
+    vector<shared_ptr<clientConnection>> clients;
+    char readChunk[4096];
+
+    while(!stopRequested) {
+        {
+            lock_guard<mutex> guard(queueLock);
+            if(stopping) {
+                break;
+            }
+        }
+
+        vector<struct pollfd> pollFds(clients.size() + 1);
+        pollFds[0].fd = listenFd;
+        pollFds[0].events = POLLIN;
+        for(size_t i=0;i<clients.size();i++) {
+            pollFds[i+1].fd = clients[i]->fd;
+            pollFds[i+1].events = POLLIN;
+        }
+
+        // Wake up now and then to notice signals and shutdown requests
+        int numReady = poll(pollFds.data(), pollFds.size(), 200);
+        if(numReady <= 0) {
+            continue;
+        }
+
+        if(pollFds[0].revents & POLLIN) {
+            int clientFd = accept(listenFd, NULL, NULL);
+            if(clientFd >= 0) {
+                clients.push_back(make_shared<clientConnection>(clientFd));
+            }
+        }
+
+        for(size_t i=0;i<clients.size();i++) {
+            if(pollFds[i+1].revents == 0) {
+                continue;
+            }
+            shared_ptr<clientConnection> client = clients[i];
+
+            ssize_t numBytes = recv(client->fd, readChunk, sizeof(readChunk), 0);
+            if(numBytes <= 0) {
+                // Jobs of a client that went away get cancelled at their next slice
+                client->disconnect();
+                continue;
+            }
+
+            client->readBuffer.append(readChunk, numBytes);
+            size_t newline;
+            while((newline = client->readBuffer.find('\n')) != string::npos) {
+                string line = client->readBuffer.substr(0, newline);
+                client->readBuffer.erase(0, newline + 1);
+                if(!line.empty() && line[line.size()-1] == '\r') {
+                    line.erase(line.size()-1);
+                }
+                handleLine(client, line);
+            }
+            if(client->readBuffer.size() > maxLineBytes) {
+                client->send("error line too long");
+                client->disconnect();
+                client->readBuffer.clear();
+            }
+        }
+
+        // Drop disconnected clients
+        vector<shared_ptr<clientConnection>> stillConnected;
+        for(size_t i=0;i<clients.size();i++) {
+            if(!clients[i]->isClosed()) {
+                stillConnected.push_back(clients[i]);
+            }
+        }
+        clients.swap(stillConnected);
+    }
+
+    {
+        lock_guard<mutex> guard(queueLock);
+        stopping = true;
+    }
+    queueReady.notify_all();
+    for(size_t i=0;i<workers.size();i++) {
+        workers[i].join();
+    }
+
+    // Whatever did not get to finish is reported as cancelled
+    vector<shared_ptr<foldJob>> unfinished;
+    for(auto &active : activeJobs) {
+        unfinished.push_back(active.second);
+    }
+    for(size_t i=0;i<unfinished.size();i++) {
+        finishJob(unfinished[i], "cancelled");
+    }
+
+    ::close(listenFd);
+    unlink(socketPath.c_str());
+    fprintf(stderr, "Folding daemon stopped\n");
+    return 0;
+}
+
+
+void FoldingDaemon::handleLine(const shared_ptr<clientConnection> &client, const string &line) {
+    vector<string> tokens;
+    size_t start = 0;
+    while(start < line.size()) {
+        size_t end = line.find_first_of(" \t", start);
+        if(end == string::npos) {
+            end = line.size();
+        }
+        if(end > start) {
+            tokens.push_back(line.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    if(tokens.empty()) {
+        return;
+    }
+
+    if(tokens[0] == "fold") {
+        submitJob(client, tokens);
+    } else if(tokens[0] == "cancel" && tokens.size() == 2) {
+        lock_guard<mutex> guard(queueLock);
+        auto found = activeJobs.find(atol(tokens[1].c_str()));
+        if(found == activeJobs.end()) {
+            client->send("error unknown job " + tokens[1]);
+        } else {
+            found->second->cancelled = true;
+            // A job waiting for memory has to get back to a worker to notice
+            requeueDeferred();
+        }
+    } else if(tokens[0] == "status") {
+        lock_guard<mutex> guard(queueLock);
+        client->send("status queued=" + to_string(queue.size()) + " running=" + to_string(numRunning) + " workers=" + to_string(numWorkers) +
+                     " deferred=" + to_string(deferred.size()));
+    } else if(tokens[0] == "shutdown") {
+        lock_guard<mutex> guard(queueLock);
+        stopping = true;
+    } else {
+        client->send("error unknown command " + tokens[0]);
+    }
+}
+
+
+void FoldingDaemon::submitJob(const shared_ptr<clientConnection> &client, const vector<string> &tokens) {
+    if(tokens.size() < 2) {
+        client->send("error fold needs a sequence");
+        return;
+    }
+
+    shared_ptr<foldJob> job = make_shared<foldJob>();
+    job->client = client;
+    job->proteinSequence = tokens[1];
+    job->engineName = defaults.engine;
+    job->targetFitness = INT_MIN;
+    job->priority = 0;
+    job->maxGenerations = 0;
+    job->maxSeconds = 0;
+    job->reservedBytes = 0;
+    job->cpuSeconds = 0;
+    job->lastReported = 1;
+    job->cancelled = false;
+
+    for(size_t i=0;i<job->proteinSequence.size();i++) {
+        char c = job->proteinSequence[i];
+        if(c >= 'A' && c <= 'Z') {
+            job->proteinSequence[i] = c - 'A' + 'a';
+        }
+    }
+    if(job->proteinSequence.size() < 3) {
+        client->send("error sequence too short");
+        return;
+    }
+    // The random folds are laid out on a grid maxFitnessLimit cells from the middle
+    if(defaults.maxFitnessLimit < 1 || job->proteinSequence.size() > (size_t)defaults.maxFitnessLimit) {
+        client->send("error sequence longer than maxFitnessLimit");
+        return;
+    }
+    // Residues the energy model does not know would index past its pair table
+    const string &alphabet = getEnergyModel(defaults).alphabet;
+    for(size_t i=0;i<job->proteinSequence.size();i++) {
+        char c = job->proteinSequence[i];
+        if(alphabet.find(c) == string::npos && alphabet.find((char)toupper((unsigned char)c)) == string::npos) {
+            client->send("error bad residue " + string(1, c) + " in sequence");
+            return;
+        }
+    }
+
+    for(size_t i=2;i<tokens.size();i++) {
+        size_t equals = tokens[i].find('=');
+        if(equals == string::npos) {
+            client->send("error bad argument " + tokens[i]);
+            return;
+        }
+        string key = tokens[i].substr(0, equals);
+        string value = tokens[i].substr(equals + 1);
+
+        if(key == "engine") {
+            job->engineName = value;
+        } else if(key == "generations") {
+            job->maxGenerations = atol(value.c_str());
+        } else if(key == "seconds") {
+            job->maxSeconds = atof(value.c_str());
+        } else if(key == "priority") {
+            job->priority = atoi(value.c_str());
+        } else if(key == "target") {
+            // Same as the input file, a target of 0 or higher runs until the budget is spent
+            job->targetFitness = atoi(value.c_str());
+            if(job->targetFitness >= 0) {
+                job->targetFitness = INT_MIN;
+            }
+        } else if(key == "tag") {
+            job->tag = value;
+        } else {
+            client->send("error unknown argument " + key);
+            return;
+        }
+    }
+
+    // Make sure the engine exists before queueing, it is built on a worker
+    if(!hasEngine(job->engineName)) {
+        client->send("error unknown engine " + job->engineName);
+        return;
+    }
+
+    {
+        lock_guard<mutex> guard(queueLock);
+        job->id = nextJobId++;
+        job->order = nextOrder++;
+        activeJobs[job->id] = job;
+        queue.push(job);
+    }
+    client->send("queued " + to_string(job->id) + (job->tag.empty() ? "" : " " + job->tag));
+    queueReady.notify_one();
+}
+
+
+void FoldingDaemon::workerLoop() {
+    while(true) {
+        shared_ptr<foldJob> job;
+        {
+            unique_lock<mutex> guard(queueLock);
+            queueReady.wait(guard, [this] { return stopping || !queue.empty(); });
+            if(stopping) {
+                return;
+            }
+
+            job = queue.top();
+            queue.pop();
+            numRunning++;
+        }
+
+        runSlice(job);
+
+        {
+            lock_guard<mutex> guard(queueLock);
+            numRunning--;
+        }
+    }
+}
+
+
+// Runs a job for one time slice, then finishes or requeues it
+void FoldingDaemon::runSlice(const shared_ptr<foldJob> &job) {
+    bool cancelled;
+    {
+        lock_guard<mutex> guard(queueLock);
+        cancelled = job->cancelled;
+    }
+    if(cancelled || job->client->isClosed()) {
+        finishJob(job, "cancelled");
+        return;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    double elapsed = 0;
+
+    if(!job->engine) {
+        // Over the memory budget the job waits for a running one to finish instead of starting.
+        // Tried under queueLock: finishJob() releases its memory before it takes the lock to
+        // requeue, so either this sees the memory free or that sees the job in deferred.
+        size_t jobBytes = estimateSearchBytes(job->engineName, job->proteinSequence.size(), defaults);
+        {
+            lock_guard<mutex> guard(queueLock);
+            if(!memoryGate().tryAcquire(jobBytes)) {
+                deferred.push_back(job);
+                return;
+            }
+        }
+        job->reservedBytes = jobBytes;
+        job->engine = createEngine(job->engineName, job->proteinSequence, job->targetFitness, defaults);
+        job->lastReported = job->engine->best().fitness + 1;
+    }
+
+    string reason;
+    while(reason.empty()) {
+        if(job->engine->step()) {
+            reason = "solved";
+        } else if(job->maxGenerations > 0 && job->engine->generation() >= job->maxGenerations) {
+            reason = "budget";
+        }
+
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if(reason.empty() && job->maxSeconds > 0 && job->cpuSeconds + elapsed >= job->maxSeconds) {
+            reason = "budget";
+        }
+        if(elapsed >= sliceSeconds) {
+            break;
+        }
+    }
+    job->cpuSeconds += elapsed;
+
+    // Stream progress whenever the best fold improves
+    const proteinNode &best = job->engine->best();
+    if(best.fitness < job->lastReported) {
+        job->lastReported = best.fitness;
+        job->client->send("progress " + to_string(job->id) + " " + to_string(job->engine->generation()) + " " +
+                          to_string(best.fitness) + " " + best.proteinDirection);
+    }
+
+    if(!reason.empty()) {
+        finishJob(job, reason);
+        return;
+    }
+
+    lock_guard<mutex> guard(queueLock);
+    if(stopping) {
+        // Reported as cancelled once the workers are joined
+        return;
+    }
+    queue.push(job);
+    queueReady.notify_one();
+}
+
+
+void FoldingDaemon::finishJob(const shared_ptr<foldJob> &job, const string &reason) {
+    string line = "done " + to_string(job->id) + " " + reason;
+    if(job->engine) {
+        const proteinNode &best = job->engine->best();
+        line += " " + to_string(job->engine->generation()) + " " + to_string(best.fitness) + " " + best.proteinDirection;
+    } else {
+        line += " 0 0 -";
+    }
+    job->client->send(line);
+
+    // Free the search now rather than when the last reference goes
+    job->engine.reset();
+    if(job->reservedBytes > 0) {
+        memoryGate().release(job->reservedBytes);
+        job->reservedBytes = 0;
+    }
+
+    lock_guard<mutex> guard(queueLock);
+    activeJobs.erase(job->id);
+    requeueDeferred();
+}
+
+// Called with queueLock held
+void FoldingDaemon::requeueDeferred() {
+    if(deferred.empty()) {
+        return;
+    }
+    for(size_t i=0;i<deferred.size();i++) {
+        queue.push(deferred[i]);
+    }
+    deferred.clear();
+    queueReady.notify_all();
+}
+
+
+int runFoldingDaemon(const string &socketPath, const foldingOptions &defaults, int numWorkers) {
+    FoldingDaemon daemon(defaults, numWorkers);
+    return daemon.run(socketPath);
+}
@@ -0,0 +1,33 @@
+#ifndef FOLDINGDAEMON_H
+#define FOLDINGDAEMON_H
+
+#include <string>
+
+#include "foldingengine.h"
+
+// Long-running folding service listening on a Unix domain socket.
+//
+// Clients send one command per line:
+//   fold <sequence> [engine=ga|replica|steady|pivot|wanglandau|aco] [generations=N] [seconds=S] [priority=P] [target=F] [tag=T]
+//   cancel <job>
+//   status
+//   shutdown
+//
+// and get lines back:
+//   queued <job> [tag]
+//   progress <job> <generation> <fitness> <directions>
+//   done <job> <solved|budget|cancelled> <generation> <fitness> <directions>
+//   status queued=<n> running=<n> workers=<n> deferred=<n>
+//   error <message>
+//
+// Jobs run on a shared pool of worker threads in time slices. The queue is
+// ordered by priority, then by how much CPU time a job has already had, so
+// a short job submitted behind long ones gets a worker at the next slice.
+// A job with no budget and an unreachable target runs until it is cancelled.
+// Under a memory budget (see memorybudget.h) a job only starts once its
+// search fits next to the ones already started, until then it is deferred.
+//
+// numWorkers of 0 uses one worker per core. Returns the exit code for main().
+int runFoldingDaemon(const std::string &socketPath, const foldingOptions &defaults, int numWorkers);
+
+#endif // FOLDINGDAEMON_H
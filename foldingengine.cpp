@@ -0,0 +1,549 @@
+#include "foldingengine.h"
+#include "replicaexchange.h"
+#include "steadystate.h"
+#include "pivotengine.h"
+#include "wanglandau.h"
+#include "antcolony.h"
+#include "localsearch.h"
+#include "perfcounters.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdlib>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+
+static inline double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+bool applyOption(foldingOptions &options, const string &key, const string &value) {
+    if (key == "engine") {
+        options.engine = value;
+    } else if (key == "energyModel") {
+        options.energyModel = value;
+    } else if (key == "engineThreads") {
+        options.engineThreads = stoi(value);
+    } else if (key == "maxFitnessLimit") {
+        options.maxFitnessLimit = stoi(value);
+    } else if (key == "popNum") {
+        options.popNum = stoi(value);
+    } else if (key == "elitePercentage") {
+        options.elitePercentage = stoi(value);
+    } else if (key == "mutatePercentage") {
+        options.mutatePercentage = stoi(value);
+    } else if (key == "crossoverPercentage") {
+        options.crossoverPercentage = stoi(value);
+    } else if (key == "numToTry") {
+        options.numToTry = stoi(value);
+    } else if (key == "checkForDupeInterval") {
+        options.checkForDupeInterval = stoi(value);
+    } else if (key == "adaptiveOperators") {
+        options.adaptiveOperators = stoi(value);
+    } else if (key == "adaptiveWindow") {
+        options.adaptiveWindow = stoi(value);
+    } else if (key == "adaptiveMinShare") {
+        options.adaptiveMinShare = stod(value);
+    } else if (key == "apocalypse") {
+        options.apocalypse = stoi(value);
+    } else if (key == "apocRepeatTrigger") {
+        options.apocRepeatTrigger = stoi(value);
+    } else if (key == "apocPolicy") {
+        options.apocPolicy = value;
+    } else if (key == "apocGrowth") {
+        options.apocGrowth = stod(value);
+    } else if (key == "apocSubPopulations") {
+        options.apocSubPopulations = stoi(value);
+    } else if (key == "apocGenerations") {
+        options.apocGenerations = stoi(value);
+    } else if (key == "apocFreshShare") {
+        options.apocFreshShare = stod(value);
+    } else if (key == "niching") {
+        options.niching = value;
+    } else if (key == "nicheRadius") {
+        options.nicheRadius = stoi(value);
+    } else if (key == "nicheCapacity") {
+        options.nicheCapacity = stoi(value);
+    } else if (key == "reReplicas") {
+        options.reReplicas = stoi(value);
+    } else if (key == "reMinTemperature") {
+        options.reMinTemperature = stod(value);
+    } else if (key == "reMaxTemperature") {
+        options.reMaxTemperature = stod(value);
+    } else if (key == "reLadder") {
+        options.reLadder = value;
+    } else if (key == "reMovesPerSwap") {
+        options.reMovesPerSwap = stoi(value);
+    } else if (key == "steadyBirths") {
+        options.steadyBirths = stoi(value);
+    } else if (key == "pivotMovesPerStep") {
+        options.pivotMovesPerStep = stoi(value);
+    } else if (key == "pivotStartTemperature") {
+        options.pivotStartTemperature = stod(value);
+    } else if (key == "pivotEndTemperature") {
+        options.pivotEndTemperature = stod(value);
+    } else if (key == "pivotCoolingSteps") {
+        options.pivotCoolingSteps = stoi(value);
+    } else if (key == "memeticElites") {
+        options.memeticElites = stoi(value);
+    } else if (key == "memeticMoves") {
+        options.memeticMoves = stoi(value);
+    } else if (key == "acoAnts") {
+        options.acoAnts = stoi(value);
+    } else if (key == "acoAlpha") {
+        options.acoAlpha = stod(value);
+    } else if (key == "acoBeta") {
+        options.acoBeta = stod(value);
+    } else if (key == "acoEvaporation") {
+        options.acoEvaporation = stod(value);
+    } else if (key == "acoElites") {
+        options.acoElites = stoi(value);
+    } else if (key == "acoPolishMoves") {
+        options.acoPolishMoves = stoi(value);
+    } else if (key == "wlWindows") {
+        options.wlWindows = stoi(value);
+    } else if (key == "wlOverlap") {
+        options.wlOverlap = stod(value);
+    } else if (key == "wlMovesPerExchange") {
+        options.wlMovesPerExchange = stoi(value);
+    } else if (key == "wlFlatness") {
+        options.wlFlatness = stod(value);
+    } else if (key == "wlFinalLogF") {
+        options.wlFinalLogF = stod(value);
+    } else if (key == "wlKeepFolds") {
+        options.wlKeepFolds = stoi(value);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+const energyModel &getEnergyModel(const foldingOptions &options) {
+    static const energyModel hpModel = hpEnergyModel();
+
+    string error;
+    const energyModel *model = findEnergyModel(options.energyModel, error);
+    if(model == NULL) {
+        fprintf(stderr, "%s\nUsing the HP model...\n", error.c_str());
+        return hpModel;
+    }
+    return *model;
+}
+
+
+int engineThreadCount(const foldingOptions &options) {
+    if(options.engineThreads > 0) {
+        return options.engineThreads;
+    }
+    return max(1, (int)thread::hardware_concurrency());
+}
+
+int engineThreadsEach(int numEngines) {
+    return max(1, (int)thread::hardware_concurrency() / max(numEngines, 1));
+}
+
+
+bool hasEngine(const string &name) {
+    return name == "ga" || name == "replica" || name == "steady" || name == "pivot" || name == "wanglandau" || name == "aco";
+}
+
+unique_ptr<FoldingEngine> createEngine(const string &name, const string &proteinSequence, int targetFitness, const foldingOptions &options) {
+    if(name == "ga") {
+        return unique_ptr<FoldingEngine>(new GeneticEngine(proteinSequence, targetFitness, options));
+    } else if(name == "replica") {
+        return unique_ptr<FoldingEngine>(new ReplicaExchangeEngine(proteinSequence, targetFitness, options));
+    } else if(name == "steady") {
+        return unique_ptr<FoldingEngine>(new SteadyStateEngine(proteinSequence, targetFitness, options));
+    } else if(name == "pivot") {
+        return unique_ptr<FoldingEngine>(new PivotEngine(proteinSequence, targetFitness, options));
+    } else if(name == "wanglandau") {
+        return unique_ptr<FoldingEngine>(new WangLandauEngine(proteinSequence, targetFitness, options));
+    } else if(name == "aco") {
+        return unique_ptr<FoldingEngine>(new AntColonyEngine(proteinSequence, targetFitness, options));
+    }
+    return unique_ptr<FoldingEngine>();
+}
+
+
+
+GeneticEngine::GeneticEngine(const string &proteinSequence, int targetFitness, const foldingOptions &options) :
+    FoldingEngine(targetFitness),
+    proteinSequence(proteinSequence),
+    hIndex(buildContactIndex(proteinSequence, getEnergyModel(options))),
+    options(options),
+    generationNum(0),
+    currentFitness(0),
+    topFitness(0),
+    apocCounter(0),
+    apocLastFitness(0),
+    numApoc(0),
+    numSurvivors(0),
+    duplicatesRemoved(-1),
+    apocalypseHit(false),
+    survivorKept(false),
+    numNiches(-1),
+    polishPool(options.memeticElites > 0 ? min(options.memeticElites, engineThreadCount(options)) : 1)
+{
+    int popNum = options.popNum;
+    currSize = proteinSequence.size();
+    numElite = (options.elitePercentage/100.0) * popNum;
+    numMutate = (options.mutatePercentage/100.0) * popNum;
+    numCrossover = (options.crossoverPercentage/100.0) * popNum;
+
+    // Adjust apocRepeatTimer based on size of input (-10 == x1.0, -14 == x1.4 etc)
+    apocRepeatTriggerAdj = options.apocRepeatTrigger * (abs((long)targetFitness) * 0.1);
+
+    // The configured percentages are where the adaptive shares start
+    double baseShares[numGeneticOperators];
+    baseShares[operatorCrossover] = max(numCrossover - numElite, 0);
+    baseShares[operatorRandom] = max(popNum - max(numCrossover, numElite), 0);
+    baseShares[operatorMutate] = max(numMutate, 0);
+    operatorBudget = baseShares[operatorCrossover] + baseShares[operatorRandom] + baseShares[operatorMutate];
+    operatorControl.configure(baseShares, options.adaptiveWindow, options.adaptiveMinShare);
+
+    restarts.configure(options.apocPolicy, options.apocGrowth, options.apocSubPopulations, options.apocGenerations);
+
+    nicheRadius = options.nicheRadius > 0 ? options.nicheRadius : max(1, currSize / 20);
+
+    // Generate initial population
+    population = generateInitialPop(popNum, currSize, options.maxFitnessLimit);
+
+    // Generate the fitness rating for each member of the population
+    for(int i=0;i<popNum;i++) {
+        population[i].fitness = getFitnessRating(hIndex, population[i].proteinDirection);
+    }
+
+    // Sort the vector based on the fitness rating
+    sort(population.begin(), population.end(), ascending());
+}
+
+
+// Picks two different parents and crosses them over, retrying with new parents until it works
+proteinNode GeneticEngine::breedChild(const vector<proteinNode> &parents) {
+    int calls;
+    int parentFitness;
+    return breedChild(parents, calls, parentFitness);
+}
+
+proteinNode GeneticEngine::breedChild(const vector<proteinNode> &parents, int &calls, int &parentFitness) {
+    proteinNode parent1 = grabParent(parents, numElite);
+    proteinNode parent2 = grabParent(parents, numElite);
+    // Makes sure the second parent isn't the same
+    while(parent1.proteinDirection == parent2.proteinDirection) {
+        parent2 = grabParent(parents, numElite);
+    }
+
+    // If the crossover fails...
+    proteinNode child = crossover(parent1, parent2, options.numToTry, options.maxFitnessLimit, hIndex);
+    calls = 1;
+    while(child.proteinDirection == "failed") {
+        // Choose new parents
+        parent1 = grabParent(parents, numElite);
+        parent2 = grabParent(parents, numElite);
+        // Make sure the second parent isn't the same
+        while(parent1.proteinDirection == parent2.proteinDirection) {
+            parent2 = grabParent(parents, numElite);
+        }
+
+        child = crossover(parent1, parent2, options.numToTry, options.maxFitnessLimit, hIndex);
+        calls++;
+    }
+
+    parentFitness = min(parent1.fitness, parent2.fitness);
+    return child;
+}
+
+
+// Polishes the top memeticElites of a sorted population in parallel, one elite at a time per thread
+void GeneticEngine::polishElites(vector<proteinNode> &sorted) {
+    int numPolish = min(options.memeticElites, (int)sorted.size());
+    polishPool.run(numPolish, [&](int i, int) {
+        sorted[i].fitness = polishFold(hIndex, sorted[i].proteinDirection, sorted[i].fitness, options.memeticMoves);
+    });
+
+    // They only got better, so they are still ahead of everyone else
+    sort(sorted.begin(), sorted.begin() + numPolish, ascending());
+}
+
+
+bool GeneticEngine::step() {
+    int popNum = options.popNum;
+    int maxFitnessLimit = options.maxFitnessLimit;
+
+    generationNum++;
+    duplicatesRemoved = -1;
+    apocalypseHit = false;
+    survivorKept = false;
+
+    // Reuse the second population vector
+    nextPopulation.clear();
+
+
+    // Transfer the elite population
+    for(int i=0;i<numElite;i++) {
+        nextPopulation.push_back(population[i]);
+    }
+
+
+    // How many children are bred and how many mutations made, the adaptive controller's shares if it is on
+    bool adaptive = options.adaptiveOperators != 0;
+    // Gains only count past the fitness it takes to be an elite, which a random fold beating a poor parent does not reach
+    int eliteCut = population[max(numElite, 1) - 1].fitness;
+    int crossoverUntil = numCrossover;
+    int numMutations = numMutate;
+    double fillShare = operatorControl.getShare(operatorCrossover) + operatorControl.getShare(operatorRandom);
+    if(adaptive && fillShare > 0) {
+        crossoverUntil = numElite + (int)lround((popNum - numElite) * operatorControl.getShare(operatorCrossover) / fillShare);
+        numMutations = min(popNum, (int)lround(operatorBudget * operatorControl.getShare(operatorMutate)));
+    }
+
+    // While the population is less than the max size, keep crossing over
+    while((int)nextPopulation.size() < crossoverUntil) {
+        if(adaptive) {
+            // Scored right away to measure the gain, which also keeps the sort below honest
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            int calls;
+            int parentFitness;
+            proteinNode child = breedChild(population, calls, parentFitness);
+            child.fitness = getFitnessRating(hIndex, child.proteinDirection);
+            operatorControl.record(operatorCrossover, calls, 1, min(parentFitness, eliteCut) - child.fitness, secondsSince(start));
+            nextPopulation.push_back(child);
+        } else {
+            nextPopulation.push_back(breedChild(population));
+        }
+    }
+
+    while((int)nextPopulation.size() < popNum) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        proteinNode child;
+        child.proteinDirection = createRandomSequence(currSize, maxFitnessLimit);
+
+        if(adaptive) {
+            child.fitness = getFitnessRating(hIndex, child.proteinDirection);
+            operatorControl.record(operatorRandom, 1, 1, eliteCut - child.fitness, secondsSince(start));
+        }
+
+        nextPopulation.push_back(child);
+    }
+
+
+    // Need to sort here in case there is a higher fit after the crossovers
+    {
+        KernelProbe probe(kernelSort);
+        sort(nextPopulation.begin(), nextPopulation.end(), ascending());
+    }
+
+
+    // Mutates non-elite population randomly
+    for(int i=0;i<numMutations;i++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        // Grabs index for which non-elite to mutate and mutates it
+        int mutateIndex = (foldRand() % popNum);
+        string mutated = mutate(nextPopulation[mutateIndex].proteinDirection, options.numToTry, maxFitnessLimit);
+        int calls = 1;
+
+        // While the mutation is not valid, keep choosing a new
+        while(mutated == "failed") {
+            mutateIndex = (foldRand() % popNum);
+            mutated = mutate(nextPopulation[mutateIndex].proteinDirection, options.numToTry, maxFitnessLimit);
+            calls++;
+        }
+
+        // Will not save mutation if it is an elite and the fitness is worse, however it will switch if the fitness is equal
+        int saveMutation = 1;
+        int fitnessMutated = getFitnessRating(hIndex, mutated);
+        if(mutateIndex < numElite) {
+            int fitnessOrig = getFitnessRating(hIndex, nextPopulation[mutateIndex].proteinDirection);
+
+            if(fitnessOrig > fitnessMutated) {
+                saveMutation = 0;
+            }
+        }
+
+        // Every fold in nextPopulation is scored when the controller is on
+        if(adaptive) {
+            int gain = saveMutation == 1 ? min(nextPopulation[mutateIndex].fitness, eliteCut) - fitnessMutated : 0;
+            operatorControl.record(operatorMutate, calls, 1, gain, secondsSince(start));
+        }
+
+        if(saveMutation == 1) {
+            nextPopulation[mutateIndex].proteinDirection = mutated;
+            nextPopulation[mutateIndex].fitness = fitnessMutated;
+        } else {
+            i--;
+        }
+    }
+
+    if(adaptive) {
+        operatorControl.update();
+    }
+
+    // Calculate the fitness levels for the nextPopulation
+    for(int i=0;i<popNum;i++) {
+        nextPopulation[i].fitness = getFitnessRating(hIndex, nextPopulation[i].proteinDirection);
+    }
+
+    // APOCALYPSE: once the fresh populations grown in the background are done, they join the survivors
+    if(restarts.ready()) {
+        mergeRestart();
+    }
+
+    // Check for duplicates. Replace with a crossover if it is a duplicate (Ensures duplicate elites don't stack)
+    // Done every checkForDupeInterval generations to allow for brief stacking (for higher selection possibility of fit individuals)
+    if(generationNum % options.checkForDupeInterval == 0) {
+        KernelProbe probe(kernelDedup);
+        unordered_map<string, int> duplicateCheck;
+        int numDuplicates = 0;
+        for(int i=0;i<popNum;i++) {
+            if(duplicateCheck[nextPopulation[i].proteinDirection] == 1) {
+                nextPopulation[i] = breedChild(nextPopulation);
+                numDuplicates++;
+            } else {
+                duplicateCheck[nextPopulation[i].proteinDirection] = 1;
+            }
+        }
+
+        duplicatesRemoved = numDuplicates;
+    }
+
+    // Sort the vector based on the fitness rating
+    {
+        KernelProbe probe(kernelSort);
+        sort(nextPopulation.begin(), nextPopulation.end(), ascending());
+    }
+
+    // Rank near-copies of fitter folds behind them, so selection and the elites spread over more folds
+    if(options.niching == "clearing") {
+        numNiches = nicheRanker.clear(nextPopulation, nicheRadius, max(options.nicheCapacity, 1));
+    } else if(options.niching == "sharing") {
+        numNiches = nicheRanker.share(nextPopulation, nicheRadius);
+    }
+
+    // Memetic stage: local search on the best few instead of waiting for a lucky mutation
+    if(options.memeticElites > 0) {
+        polishElites(nextPopulation);
+    }
+
+    if(apocLastFitness == nextPopulation[0].fitness) {
+        apocCounter++;
+    } else {
+        apocCounter = 0;
+        apocLastFitness = nextPopulation[0].fitness;
+    }
+
+    currentFitness = nextPopulation[0].fitness;
+    population.swap(nextPopulation);
+
+    if(currentFitness < topFitness) {
+        topFitness = currentFitness;
+    }
+
+    // Start the next restart once the best has been stuck for the scheduler's interval
+    if(options.apocalypse == 1 && !restarts.running() && apocCounter > restarts.interval(apocRepeatTriggerAdj)) {
+        restarts.launch(proteinSequence, targetFitness, options);
+    }
+
+    return currentFitness <= targetFitness;
+}
+
+
+// Joins the fresh populations of a finished restart with the best of the scored nextPopulation
+void GeneticEngine::mergeRestart() {
+    int popNum = options.popNum;
+    vector<proteinNode> fresh = restarts.collect();
+    sort(nextPopulation.begin(), nextPopulation.end(), ascending());
+
+    int numFresh = min((int)fresh.size(), (int)lround(popNum * min(max(options.apocFreshShare, 0.0), 1.0)));
+    // However large the fresh share, the elites (and so the best fold) stay
+    int numKept = min(popNum, max(popNum - numFresh, max(numElite, 1)));
+
+    // Survivors first, then the fresh folds, then whatever is left of either to make up popNum
+    vector<proteinNode> merged;
+    unordered_set<string> taken;
+    auto take = [&](const vector<proteinNode> &from, size_t first, size_t last) {
+        for(size_t i=first;i<last && i<from.size() && (int)merged.size()<popNum;i++) {
+            if(taken.insert(from[i].proteinDirection).second) {
+                merged.push_back(from[i]);
+            }
+        }
+    };
+    take(nextPopulation, 0, numKept);
+    take(fresh, 0, fresh.size());
+    take(nextPopulation, numKept, nextPopulation.size());
+    // Only short of popNum if both sides are mostly copies of each other
+    for(size_t i=0;(int)merged.size()<popNum;i++) {
+        merged.push_back(nextPopulation[i % nextPopulation.size()]);
+    }
+
+    // From what was merged: the old best made it in and nothing in there beats it
+    int mergedBest = merged[0].fitness;
+    for(size_t i=1;i<merged.size();i++) {
+        mergedBest = min(mergedBest, merged[i].fitness);
+    }
+    apocalypseHit = true;
+    survivorKept = !nextPopulation.empty() && taken.count(nextPopulation[0].proteinDirection) > 0 &&
+                   nextPopulation[0].fitness <= mergedBest;
+    if(survivorKept) {
+        numSurvivors++;
+    }
+
+    nextPopulation.swap(merged);
+    apocCounter = 0;
+    numApoc++;
+}
+
+
+string GeneticEngine::lastOperatorReport() const {
+    if(options.adaptiveOperators == 0) {
+        return "";
+    }
+    return operatorControl.describe();
+}
+
+
+void GeneticEngine::acceptMigrants(const vector<proteinNode> &migrants) {
+    int numReplaced = 0;
+    for(size_t m=0;m<migrants.size() && numReplaced < (int)population.size()-numElite;m++) {
+        // Skip folds this population already has
+        bool known = false;
+        for(size_t i=0;i<population.size();i++) {
+            if(population[i].proteinDirection == migrants[m].proteinDirection) {
+                known = true;
+                break;
+            }
+        }
+        if(known) {
+            continue;
+        }
+
+        proteinNode &replaced = population[population.size() - 1 - numReplaced];
+        replaced.proteinDirection = migrants[m].proteinDirection;
+        replaced.fitness = getFitnessRating(hIndex, replaced.proteinDirection);
+        numReplaced++;
+    }
+
+    if(numReplaced > 0) {
+        sort(population.begin(), population.end(), ascending());
+        if(population[0].fitness < topFitness) {
+            topFitness = population[0].fitness;
+        }
+    }
+}
+
+void GeneticEngine::seedFolds(const vector<string> &folds) {
+    vector<proteinNode> seeds;
+    for(size_t i=0;i<folds.size();i++) {
+        proteinNode seed;
+        seed.proteinDirection = folds[i];
+        seeds.push_back(seed);
+    }
+    acceptMigrants(seeds);
+}
@@ -0,0 +1,252 @@
+#ifndef FOLDINGENGINE_H
+#define FOLDINGENGINE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "folding.h"
+#include "contactindex.h"
+#include "niching.h"
+#include "operatorcontrol.h"
+#include "restartscheduler.h"
+#include "workerpool.h"
+
+// All the user-modifiable options for the search, read from Options.txt
+struct foldingOptions {
+    // Search engine used for each test case, see createEngine()
+    std::string engine = "ga";
+
+    // Fitness level can be from zero to 1024
+    int maxFitnessLimit = 1024;
+
+    // Contact energies: "hp", "hpnx" or an energy model file (see energymodel.h).
+    // Fitness, targets and temperatures are in the model's fixed-point units.
+    std::string energyModel = "hp";
+
+    // Threads each engine runs its parallel loops on, 0 for one per core.
+    // Callers running several engines at once share the cores out between them
+    int engineThreads = 0;
+
+    // Genetic options:
+    int popNum = 200;
+    // Percentages, calculated into the exact numbers based on popNum
+    int elitePercentage = 5;
+    int mutatePercentage = 50;
+    int crossoverPercentage = 70;
+
+    // NOTE: Controls 2 things: Number of times to attempt a crossover AND mutation before failure
+    int numToTry = 5;
+
+    // Deduplication on the population is done every x generations
+    int checkForDupeInterval = 500;
+
+    // Adaptive operator rates: each generation's crossovers, random folds and
+    // mutations are shared by the fitness each gained per second lately
+    // (see operatorcontrol.h) instead of by the fixed percentages above
+    int adaptiveOperators = 0;
+    // Generations the gains are averaged over
+    int adaptiveWindow = 20;
+    // Share of the budget every operator keeps
+    double adaptiveMinShare = 0.05;
+
+    // APOCALYPSE Options
+    // Apocalypse restarts the search if the fitness hasn't gotten better after the repeatTrigger's amount:
+    // fresh populations evolve on background threads while the search goes on, then join its survivors
+    int apocalypse = 0;
+    int apocRepeatTrigger = 200;
+    // How the trigger grows from one restart to the next: "fixed", "luby" or "geometric" (see restartscheduler.h)
+    std::string apocPolicy = "luby";
+    double apocGrowth = 1.5;
+    // Fresh populations per restart, each on its own thread, and the generations they evolve before joining
+    int apocSubPopulations = 1;
+    int apocGenerations = 50;
+    // Share of the merged population that comes from the fresh ones
+    double apocFreshShare = 0.5;
+
+    // Niching options (GA, see niching.h), applied every generation
+    // "none", "clearing" or "sharing"
+    std::string niching = "none";
+    // Folds whose turns differ in at most this many places share a niche, 0 for a twentieth of the chain
+    int nicheRadius = 0;
+    // Folds clearing keeps per niche
+    int nicheCapacity = 1;
+
+    // Replica exchange options
+    // Number of replicas, swept in parallel on the engine's threads. 0 for one per core (at least 2)
+    int reReplicas = 0;
+    // Temperature ladder between the two, spaced "geometric" or "linear"
+    double reMinTemperature = 0.3;
+    double reMaxTemperature = 3.0;
+    std::string reLadder = "geometric";
+    // Moves each replica makes between neighbour swap attempts
+    int reMovesPerSwap = 50;
+
+    // Steady-state options
+    // Children made per step(), 0 for popNum (about one GA generation)
+    int steadyBirths = 0;
+
+    // Long-chain (pivot) options
+    // Pivot attempts per step()
+    int pivotMovesPerStep = 1000;
+    // Annealing from the start to the end temperature over pivotCoolingSteps steps
+    double pivotStartTemperature = 2.0;
+    double pivotEndTemperature = 0.25;
+    int pivotCoolingSteps = 2000;
+
+    // Memetic options (GA)
+    // Number of top elites polished by local search each generation, 0 for none
+    int memeticElites = 0;
+    // Moves tried per polished elite
+    int memeticMoves = 200;
+
+    // Ant colony options (see antcolony.h)
+    // Ants built per step(), in parallel on the engine's threads
+    int acoAnts = 100;
+    // Weights of the pheromone and of the contact heuristic when an ant picks its next turn
+    double acoAlpha = 1.0;
+    double acoBeta = 2.0;
+    // Fraction of the pheromone that evaporates every step()
+    double acoEvaporation = 0.2;
+    // Best ants polished by local search and laying pheromone every step()
+    int acoElites = 5;
+    // Moves tried per polished ant, 0 for no polishing
+    int acoPolishMoves = 200;
+
+    // Wang-Landau options (density of states, see wanglandau.h)
+    // Energy windows, walked in parallel on the engine's threads. 0 for one per core
+    int wlWindows = 0;
+    // Fraction of a window shared with each neighbour
+    double wlOverlap = 0.75;
+    // Moves each walker makes between exchange attempts
+    int wlMovesPerExchange = 10000;
+    // A histogram is flat once its lowest bin reaches this fraction of its mean
+    double wlFlatness = 0.8;
+    // Converged once ln f is below this in every window
+    double wlFinalLogF = 1e-6;
+    // Distinct lowest-energy folds kept
+    int wlKeepFolds = 20;
+};
+
+// Sets one "key = value" option, returns false if the key is not a search option
+bool applyOption(foldingOptions &options, const std::string &key, const std::string &value);
+
+// The energy model named by the options, the HP model if it cannot be loaded
+const energyModel &getEnergyModel(const foldingOptions &options);
+
+// Threads an engine built with these options may use, at least 1
+int engineThreadCount(const foldingOptions &options);
+// Threads for each of numEngines engines run side by side, so together they use every core once
+int engineThreadsEach(int numEngines);
+
+
+// Common interface of the search engines, so callers can step any of them
+// a generation at a time and look at the best fold found so far
+class FoldingEngine
+{
+public:
+    FoldingEngine(int targetFitness) : targetFitness(targetFitness) {}
+    virtual ~FoldingEngine() {}
+
+    // Runs one generation (or sweep), returns true once the target is reached
+    virtual bool step() = 0;
+
+    virtual const proteinNode &best() const = 0;
+    virtual int generation() const = 0;
+
+    // Adds known good folds (e.g. from the results store) to the search
+    // between steps, engines that cannot use them ignore them
+    virtual void seedFolds(const std::vector<std::string> &folds) { (void)folds; }
+
+    bool isSolved() const { return best().fitness <= targetFitness; }
+    int getTargetFitness() const { return targetFitness; }
+
+protected:
+    int targetFitness;
+};
+
+// True if createEngine() has an engine registered under name
+bool hasEngine(const std::string &name);
+// Builds the engine registered under name ("ga", "replica", "steady", "pivot", "wanglandau", "aco"), NULL if there is none
+std::unique_ptr<FoldingEngine> createEngine(const std::string &name, const std::string &proteinSequence, int targetFitness, const foldingOptions &options);
+
+
+// The generational genetic algorithm: elites, crossover, random fill, mutation
+class GeneticEngine : public FoldingEngine
+{
+public:
+    GeneticEngine(const std::string &proteinSequence, int targetFitness, const foldingOptions &options);
+
+    bool step();
+
+    const proteinNode &best() const { return population[0]; }
+    int generation() const { return generationNum; }
+
+    const std::vector<proteinNode> &getPopulation() const { return population; }
+
+    // Replaces the least fit individuals with migrants from another population
+    void acceptMigrants(const std::vector<proteinNode> &migrants);
+    void seedFolds(const std::vector<std::string> &folds);
+
+    // Stats for display
+    int getTopFitness() const { return topFitness; }
+    int getNumApoc() const { return numApoc; }
+    int getNumSurvivors() const { return numSurvivors; }
+
+    // What happened in the last step(): duplicates removed (-1 if no check
+    // was due), whether a restart was merged in and whether the best fold
+    // before it is still the best after it
+    int lastDuplicatesRemoved() const { return duplicatesRemoved; }
+    bool lastApocalypse() const { return apocalypseHit; }
+    bool lastSurvivor() const { return survivorKept; }
+    // Niches in the population after the last step(), -1 without niching
+    int lastNiches() const { return numNiches; }
+    // The adaptive operator shares and their gains, empty without adaptiveOperators
+    std::string lastOperatorReport() const;
+    const OperatorController &getOperatorController() const { return operatorControl; }
+
+private:
+    proteinNode breedChild(const std::vector<proteinNode> &parents);
+    // Also counts the crossover calls and gives the fitness of the fitter parent
+    proteinNode breedChild(const std::vector<proteinNode> &parents, int &calls, int &parentFitness);
+    void polishElites(std::vector<proteinNode> &sorted);
+    void mergeRestart();
+
+    std::string proteinSequence;
+    contactIndex hIndex;
+    foldingOptions options;
+
+    int currSize;
+    int numElite;
+    int numMutate;
+    int numCrossover;
+    int apocRepeatTriggerAdj;
+    // Operator applications per generation at the configured percentages
+    int operatorBudget;
+    int nicheRadius;
+
+    std::vector<proteinNode> population;
+    std::vector<proteinNode> nextPopulation;
+    NicheRanker nicheRanker;
+    OperatorController operatorControl;
+    RestartScheduler restarts;
+
+    int generationNum;
+    int currentFitness;
+    int topFitness;
+
+    int apocCounter;
+    int apocLastFitness;
+    int numApoc;
+    int numSurvivors;
+
+    int duplicatesRemoved;
+    bool apocalypseHit;
+    bool survivorKept;
+    int numNiches;
+
+    // Threads for polishing the elites, kept between generations
+    WorkerPool polishPool;
+};
+
+#endif // FOLDINGENGINE_H
@@ -0,0 +1,465 @@
+#include "islandcluster.h"
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+// Migrant slots per ring, senders drop elites while a ring is full
+static const int ringCapacity = 64;
+
+static const size_t cacheLine = 64;
+static const size_t pageSize = 4096;
+
+static size_t roundUp(size_t size, size_t multiple) {
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+
+// Shared memory layout, one anonymous MAP_SHARED mapping made before forking:
+//   control block | one status slot per island | one inbox ring per island
+// Each inbox is page aligned and first touched by its owner after pinning,
+// so it lands on the NUMA node of the island that reads it.
+struct controlBlock {
+    atomic<int> stop;
+    atomic<int> ready;
+};
+
+// Best fold of one island, guarded by a sequence lock: version is odd while
+// the island is writing, the coordinator retries until it reads an even,
+// unchanged version. The direction string follows the struct.
+struct islandStatus {
+    atomic<uint32_t> version;
+    int fitness;
+    int solved;
+    long generation;
+};
+
+// Single producer (the previous island), single consumer (the owner)
+struct ringHeader {
+    atomic<uint64_t> head;
+    char padding1[cacheLine - sizeof(atomic<uint64_t>)];
+    atomic<uint64_t> tail;
+    char padding2[cacheLine - sizeof(atomic<uint64_t>)];
+};
+
+// One migrant; the direction string follows the struct
+struct ringSlot {
+    int fitness;
+    int length;
+};
+
+
+struct sharedLayout {
+    char *base;
+    size_t size;
+    int numIslands;
+    size_t directionBytes;
+
+    size_t statusOffset;
+    size_t statusStride;
+    size_t ringOffset;
+    size_t ringStride;
+    size_t slotStride;
+
+    controlBlock *control() {
+        return (controlBlock *)base;
+    }
+    islandStatus *status(int island) {
+        return (islandStatus *)(base + statusOffset + island * statusStride);
+    }
+    char *statusDirection(int island) {
+        return (char *)(status(island) + 1);
+    }
+    ringHeader *ring(int island) {
+        return (ringHeader *)(base + ringOffset + island * ringStride);
+    }
+    ringSlot *slot(int island, uint64_t index) {
+        char *slots = (char *)(ring(island) + 1);
+        return (ringSlot *)(slots + (index % ringCapacity) * slotStride);
+    }
+};
+
+static bool mapSharedLayout(sharedLayout &layout, int numIslands, int sequenceLength) {
+    layout.numIslands = numIslands;
+    layout.directionBytes = sequenceLength + 1;
+
+    layout.statusOffset = roundUp(sizeof(controlBlock), cacheLine);
+    layout.statusStride = roundUp(sizeof(islandStatus) + layout.directionBytes, cacheLine);
+    layout.slotStride = roundUp(sizeof(ringSlot) + layout.directionBytes, cacheLine);
+    layout.ringOffset = roundUp(layout.statusOffset + numIslands * layout.statusStride, pageSize);
+    layout.ringStride = roundUp(sizeof(ringHeader) + ringCapacity * layout.slotStride, pageSize);
+    layout.size = layout.ringOffset + numIslands * layout.ringStride;
+
+    // Anonymous shared pages start zeroed, which is a valid state for every atomic here
+    void *map = mmap(NULL, layout.size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(map == MAP_FAILED) {
+        return false;
+    }
+    layout.base = (char *)map;
+    return true;
+}
+
+
+// How elites travel between islands
+class migrationTransport
+{
+public:
+    virtual ~migrationTransport() {}
+    virtual void send(const vector<proteinNode> &elites) = 0;
+    virtual void receive(vector<proteinNode> &migrants) = 0;
+};
+
+class sharedRingTransport : public migrationTransport
+{
+public:
+    sharedRingTransport(sharedLayout &layout, int island) :
+        layout(layout),
+        inbox(island),
+        outbox((island + 1) % layout.numIslands)
+    {
+    }
+
+    void send(const vector<proteinNode> &elites) {
+        ringHeader *ring = layout.ring(outbox);
+        uint64_t head = ring->head.load(memory_order_relaxed);
+        for(size_t i=0;i<elites.size();i++) {
+            if(head - ring->tail.load(memory_order_acquire) >= (uint64_t)ringCapacity) {
+                break;
+            }
+            ringSlot *slot = layout.slot(outbox, head);
+            slot->fitness = elites[i].fitness;
+            slot->length = elites[i].proteinDirection.size();
+            memcpy((char *)(slot + 1), elites[i].proteinDirection.data(), slot->length);
+            head++;
+            ring->head.store(head, memory_order_release);
+        }
+    }
+
+    void receive(vector<proteinNode> &migrants) {
+        ringHeader *ring = layout.ring(inbox);
+        uint64_t tail = ring->tail.load(memory_order_relaxed);
+        uint64_t head = ring->head.load(memory_order_acquire);
+        for(;tail<head;tail++) {
+            ringSlot *slot = layout.slot(inbox, tail);
+            proteinNode migrant;
+            migrant.fitness = slot->fitness;
+            migrant.proteinDirection.assign((char *)(slot + 1), slot->length);
+            migrants.push_back(migrant);
+        }
+        ring->tail.store(tail, memory_order_release);
+    }
+
+private:
+    sharedLayout &layout;
+    int inbox;
+    int outbox;
+};
+
+// Datagram sockets, one message per migrant: "<fitness> <directions>"
+class socketTransport : public migrationTransport
+{
+public:
+    socketTransport(int sendFd, int receiveFd) :
+        sendFd(sendFd),
+        receiveFd(receiveFd)
+    {
+    }
+
+    void send(const vector<proteinNode> &elites) {
+        for(size_t i=0;i<elites.size();i++) {
+            string message = to_string(elites[i].fitness) + " " + elites[i].proteinDirection;
+            ::send(sendFd, message.data(), message.size(), MSG_DONTWAIT);
+        }
+    }
+
+    void receive(vector<proteinNode> &migrants) {
+        vector<char> buffer(65536);
+        while(true) {
+            ssize_t numBytes = recv(receiveFd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+            if(numBytes <= 0) {
+                return;
+            }
+            string message(buffer.data(), numBytes);
+            size_t space = message.find(' ');
+            if(space == string::npos) {
+                continue;
+            }
+            proteinNode migrant;
+            migrant.fitness = atoi(message.c_str());
+            migrant.proteinDirection = message.substr(space + 1);
+            migrants.push_back(migrant);
+        }
+    }
+
+private:
+    int sendFd;
+    int receiveFd;
+};
+
+
+// NUMA HELPERS
+
+static int countNumaNodes() {
+    int numNodes = 0;
+    while(access(("/sys/devices/system/node/node" + to_string(numNodes)).c_str(), F_OK) == 0) {
+        numNodes++;
+    }
+    return numNodes;
+}
+
+// Restricts this process to the CPUs of one node, using its "0-7,16-23" cpulist
+static bool pinToNumaNode(int node) {
+    ifstream cpuFile(("/sys/devices/system/node/node" + to_string(node) + "/cpulist").c_str());
+    string cpuList;
+    if(!getline(cpuFile, cpuList)) {
+        return false;
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    size_t start = 0;
+    while(start < cpuList.size()) {
+        size_t end = cpuList.find(',', start);
+        if(end == string::npos) {
+            end = cpuList.size();
+        }
+        string range = cpuList.substr(start, end - start);
+        size_t dash = range.find('-');
+        int first = atoi(range.c_str());
+        int last = dash == string::npos ? first : atoi(range.c_str() + dash + 1);
+        for(int cpu=first;cpu<=last && cpu<CPU_SETSIZE;cpu++) {
+            CPU_SET(cpu, &cpus);
+        }
+        start = end + 1;
+    }
+
+    return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+}
+
+
+static void publishStatus(sharedLayout &layout, int island, const proteinNode &best, long generation, bool solved) {
+    islandStatus *status = layout.status(island);
+    uint32_t version = status->version.load(memory_order_relaxed);
+
+    status->version.store(version + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    status->fitness = best.fitness;
+    status->generation = generation;
+    status->solved = solved ? 1 : 0;
+    size_t length = min(best.proteinDirection.size(), layout.directionBytes - 1);
+    memcpy(layout.statusDirection(island), best.proteinDirection.data(), length);
+    layout.statusDirection(island)[length] = '\0';
+
+    status->version.store(version + 2, memory_order_release);
+}
+
+static bool readStatus(sharedLayout &layout, int island, proteinNode &best, long &generation, bool &solved) {
+    islandStatus *status = layout.status(island);
+    for(int tries=0;tries<1000;tries++) {
+        uint32_t version = status->version.load(memory_order_acquire);
+        if(version == 0) {
+            return false;
+        }
+        if(version & 1) {
+            continue;
+        }
+
+        best.fitness = status->fitness;
+        generation = status->generation;
+        solved = status->solved != 0;
+        best.proteinDirection = layout.statusDirection(island);
+
+        atomic_thread_fence(memory_order_acquire);
+        if(status->version.load(memory_order_relaxed) == version) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Body of each forked island, never returns
+static void runIsland(int island, sharedLayout &layout, migrationTransport &transport, const string &proteinSequence,
+                      int targetFitness, const foldingOptions &options, const islandOptions &islands) {
+    if(islands.pinNuma == 1) {
+        int numNodes = countNumaNodes();
+        if(numNodes > 1) {
+            pinToNumaNode(island % numNodes);
+        }
+    }
+
+    // First touch of the inbox from this island's node, then wait for everyone
+    memset((void *)layout.ring(island), 0, layout.ringStride);
+    layout.control()->ready.fetch_add(1);
+    while(layout.control()->ready.load() < layout.numIslands) {
+        this_thread::yield();
+    }
+
+    // Forked islands start from copies of the same generators
+    seedFoldRandBase(time(NULL) ^ (getpid() << 16));
+    seedFoldRand(time(NULL) ^ (getpid() << 16));
+    GeneticEngine engine(proteinSequence, targetFitness, options);
+
+    vector<proteinNode> elites;
+    vector<proteinNode> migrants;
+    while(layout.control()->stop.load(memory_order_relaxed) == 0) {
+        bool solved = engine.step();
+
+        if(engine.generation() % islands.migrationInterval == 0) {
+            const vector<proteinNode> &population = engine.getPopulation();
+            elites.assign(population.begin(), population.begin() + min((size_t)islands.migrationSize, population.size()));
+            transport.send(elites);
+
+            migrants.clear();
+            transport.receive(migrants);
+            if(!migrants.empty()) {
+                engine.acceptMigrants(migrants);
+                solved = engine.isSolved();
+            }
+        }
+
+        publishStatus(layout, island, engine.best(), engine.generation(), solved);
+
+        if(solved) {
+            layout.control()->stop.store(1);
+        }
+        if(islands.maxGenerations > 0 && engine.generation() >= islands.maxGenerations) {
+            break;
+        }
+    }
+
+    _exit(0);
+}
+
+
+bool runIslandCluster(const string &proteinSequence, int targetFitness, const foldingOptions &options,
+                      const islandOptions &islands, islandResult &result, string &error) {
+    int numIslands = max(1, islands.numIslands);
+    islandOptions settings = islands;
+    settings.migrationInterval = max(1, settings.migrationInterval);
+    foldingOptions searchOptions = options;
+    if(searchOptions.engineThreads <= 0) {
+        searchOptions.engineThreads = engineThreadsEach(numIslands);
+    }
+
+    sharedLayout layout;
+    if(!mapSharedLayout(layout, numIslands, proteinSequence.size())) {
+        error = string("Error mapping shared memory\nERROR: ") + strerror(errno);
+        return false;
+    }
+
+    // Socket links, link i carries migrants from island i-1 to island i
+    vector<int> sendFds(numIslands, -1);
+    vector<int> receiveFds(numIslands, -1);
+    if(settings.transport == "socket") {
+        for(int i=0;i<numIslands;i++) {
+            int link[2];
+            if(socketpair(AF_UNIX, SOCK_DGRAM, 0, link) < 0) {
+                error = string("Error creating socket pair\nERROR: ") + strerror(errno);
+                munmap(layout.base, layout.size);
+                return false;
+            }
+            sendFds[(i + numIslands - 1) % numIslands] = link[0];
+            receiveFds[i] = link[1];
+        }
+    } else if(settings.transport != "shm") {
+        error = "Unknown island transport: " + settings.transport;
+        munmap(layout.base, layout.size);
+        return false;
+    }
+
+    vector<pid_t> children;
+    for(int i=0;i<numIslands;i++) {
+        pid_t pid = fork();
+        if(pid < 0) {
+            error = string("Error forking island\nERROR: ") + strerror(errno);
+            layout.control()->stop.store(1);
+            layout.control()->ready.fetch_add(numIslands);
+            break;
+        }
+        if(pid == 0) {
+            if(settings.transport == "socket") {
+                socketTransport transport(sendFds[i], receiveFds[i]);
+                runIsland(i, layout, transport, proteinSequence, targetFitness, searchOptions, settings);
+            } else {
+                sharedRingTransport transport(layout, i);
+                runIsland(i, layout, transport, proteinSequence, targetFitness, searchOptions, settings);
+            }
+        }
+        children.push_back(pid);
+    }
+
+    // Coordinator: follow the islands until all of them have exited
+    result.best.fitness = 0;
+    result.best.proteinDirection = "";
+    result.generations = 0;
+    result.winningIsland = -1;
+    result.solved = false;
+
+    vector<bool> running(children.size(), true);
+    size_t numRunning = children.size();
+    while(true) {
+        for(size_t i=0;i<children.size();i++) {
+            if(running[i] && waitpid(children[i], NULL, WNOHANG) == children[i]) {
+                running[i] = false;
+                numRunning--;
+            }
+        }
+
+        for(int i=0;i<(int)children.size();i++) {
+            proteinNode best;
+            long generation;
+            bool solved;
+            if(!readStatus(layout, i, best, generation, solved)) {
+                continue;
+            }
+
+            result.generations = max(result.generations, generation);
+            if(result.winningIsland < 0 || best.fitness < result.best.fitness) {
+                result.best = best;
+                result.winningIsland = i;
+                fprintf(stderr, "Island %d  Generation: %ld  Fitness: %d / %d  Directions: %s\n",
+                        i, generation, best.fitness, targetFitness, best.proteinDirection.c_str());
+            }
+            if(solved) {
+                result.solved = true;
+                layout.control()->stop.store(1);
+            }
+        }
+
+        if(numRunning == 0) {
+            break;
+        }
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+
+    for(int i=0;i<numIslands;i++) {
+        if(sendFds[i] >= 0) {
+            close(sendFds[i]);
+        }
+        if(receiveFds[i] >= 0) {
+            close(receiveFds[i]);
+        }
+    }
+    munmap(layout.base, layout.size);
+
+    return error.empty();
+}
@@ -0,0 +1,41 @@
+#ifndef ISLANDCLUSTER_H
+#define ISLANDCLUSTER_H
+
+#include <string>
+
+#include "foldingengine.h"
+
+// Options for running one sequence on several cooperating processes
+struct islandOptions {
+    int numIslands = 2;
+
+    // Every migrationInterval generations each island sends its migrationSize
+    // best folds to the next island in the ring and takes in what it received
+    int migrationInterval = 50;
+    int migrationSize = 2;
+
+    // "shm" for lock-free rings in shared memory, "socket" for Unix datagram
+    // sockets standing in for a cross-node transport
+    std::string transport = "shm";
+
+    // Pin island i to the CPUs of NUMA node i % numNodes
+    int pinNuma = 1;
+
+    // Generations per island, 0 to run until the target is reached
+    long maxGenerations = 0;
+};
+
+struct islandResult {
+    proteinNode best;
+    long generations;
+    int winningIsland;
+    bool solved;
+};
+
+// Forks numIslands processes that each run the GA on proteinSequence and
+// exchange elites, while the calling process acts as coordinator and
+// collects the global best. Must be called before any threads are started.
+bool runIslandCluster(const std::string &proteinSequence, int targetFitness, const foldingOptions &options,
+                      const islandOptions &islands, islandResult &result, std::string &error);
+
+#endif // ISLANDCLUSTER_H
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Embeddable folding library, see foldingapi.h
+#
+# qmake libfolding.pro                          -> libfolding.a
+# qmake "CONFIG += folding_shared" libfolding.pro -> libfolding.so
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = folding
+TEMPLATE = lib
+
+CONFIG += staticlib
+
+folding_shared {
+    CONFIG -= staticlib
+    CONFIG += shared
+}
+
+include(folding.pri)
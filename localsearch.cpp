@@ -0,0 +1,450 @@
+#include "localsearch.h"
+#include "folding.h"
+
+#include <cstdlib>
+
+using namespace std;
+
+
+LatticeChain::LatticeChain(const contactIndex &hIndex, const string &proteinDirection) :
+    hIndex(hIndex),
+    length(hIndex.length),
+    xs(length),
+    ys(length),
+    moved(length, 0)
+{
+    int x = 0;
+    int y = 0;
+    occupied.reserve(2 * length);
+    for(int i=0;i<length;i++) {
+        xs[i] = x;
+        ys[i] = y;
+        occupied[packCoordinate(x, y)] = i;
+
+        char direction = proteinDirection[i];
+        if(direction == '1') {
+            y--;
+        } else if(direction == '2') {
+            x++;
+        } else if(direction == '3') {
+            y++;
+        } else if(direction == '4') {
+            x--;
+        }
+    }
+}
+
+
+// Contact energy of one residue, contacts between two moved residues are only counted from the lower index
+int LatticeChain::energyOf(int site) const {
+    if(hIndex.siteTypes[site] < 0) {
+        return 0;
+    }
+
+    static const int dx[4] = {1, -1, 0, 0};
+    static const int dy[4] = {0, 0, 1, -1};
+    int energy = 0;
+    for(int k=0;k<4;k++) {
+        int other = siteAt(xs[site] + dx[k], ys[site] + dy[k]);
+        if(other < 0 || abs(other - site) == 1 || hIndex.siteTypes[other] < 0) {
+            continue;
+        }
+        if(moved[other] && other < site) {
+            continue;
+        }
+        energy += contactEnergy(hIndex, site, other);
+    }
+    return energy;
+}
+
+// Swaps every moved residue with the spot remembered in changes, so doing it twice puts everything back
+void LatticeChain::swapPositions() {
+    for(size_t c=0;c<changes.size();c++) {
+        occupied.erase(packCoordinate(xs[changes[c].site], ys[changes[c].site]));
+    }
+    for(size_t c=0;c<changes.size();c++) {
+        siteMove &change = changes[c];
+        swap(xs[change.site], change.x);
+        swap(ys[change.site], change.y);
+        occupied[packCoordinate(xs[change.site], ys[change.site])] = change.site;
+    }
+}
+
+// Applies the changes, returns the fitness change
+int LatticeChain::applyMove() {
+    int energyBefore = 0;
+    for(size_t c=0;c<changes.size();c++) {
+        moved[changes[c].site] = 1;
+    }
+    for(size_t c=0;c<changes.size();c++) {
+        energyBefore += energyOf(changes[c].site);
+    }
+
+    swapPositions();
+
+    int energyAfter = 0;
+    for(size_t c=0;c<changes.size();c++) {
+        energyAfter += energyOf(changes[c].site);
+    }
+
+    for(size_t c=0;c<changes.size();c++) {
+        moved[changes[c].site] = 0;
+    }
+    return energyAfter - energyBefore;
+}
+
+void LatticeChain::undoMove() {
+    swapPositions();
+    changes.clear();
+}
+
+// Applies the changes if they lower the fitness, returns the fitness change
+int LatticeChain::tryMove(int &movesLeft) {
+    movesLeft--;
+
+    int fitnessChange = applyMove();
+    if(fitnessChange >= 0) {
+        // No better, put everything back
+        swapPositions();
+        fitnessChange = 0;
+    }
+    return fitnessChange;
+}
+
+// Pull move at i towards its neighbour i+step, on one side of the bond. The
+// residues on the other side follow. False if there is no room.
+bool LatticeChain::buildPull(int i, int step, int side) {
+    int anchor = i + step;
+    int behind = i - step;
+    if(anchor < 0 || anchor >= length || behind < 0 || behind >= length) {
+        return false;
+    }
+
+    // L is next to the anchor and diagonal to i, C completes the square
+    int dx = xs[anchor] - xs[i];
+    int dy = ys[anchor] - ys[i];
+    int ex = -dy * side;
+    int ey = dx * side;
+    int lx = xs[anchor] + ex;
+    int ly = ys[anchor] + ey;
+    int cx = xs[i] + ex;
+    int cy = ys[i] + ey;
+    if(!isFree(lx, ly)) {
+        return false;
+    }
+    bool cornerOnly = xs[behind] == cx && ys[behind] == cy;
+    if(!cornerOnly && !isFree(cx, cy)) {
+        return false;
+    }
+
+    changes.clear();
+    changes.push_back({i, lx, ly});
+    if(!cornerOnly) {
+        changes.push_back({behind, cx, cy});
+        // The rest follows two places up the old path until it touches the moved part again
+        int lastX = cx;
+        int lastY = cy;
+        for(int j=behind-step;j>=0 && j<length;j-=step) {
+            if(abs(xs[j] - lastX) + abs(ys[j] - lastY) == 1) {
+                break;
+            }
+            lastX = xs[j + 2*step];
+            lastY = ys[j + 2*step];
+            changes.push_back({j, lastX, lastY});
+        }
+    }
+    return true;
+}
+
+// End pull: the end residue i goes two spots away, to L next to C next to
+// where it is now, and the chain follows. False if there is no room.
+bool LatticeChain::buildEndPull(int i, int towardsC, int towardsL) {
+    static const int dx[4] = {1, -1, 0, 0};
+    static const int dy[4] = {0, 0, 1, -1};
+    int step = i == 0 ? 1 : -1;
+    int cx = xs[i] + dx[towardsC];
+    int cy = ys[i] + dy[towardsC];
+    int lx = cx + dx[towardsL];
+    int ly = cy + dy[towardsL];
+    if(!isFree(cx, cy) || !isFree(lx, ly)) {
+        return false;
+    }
+
+    changes.clear();
+    changes.push_back({i, lx, ly});
+    changes.push_back({i+step, cx, cy});
+    int lastX = cx;
+    int lastY = cy;
+    for(int j=i+2*step;j>=0 && j<length;j+=step) {
+        if(abs(xs[j] - lastX) + abs(ys[j] - lastY) == 1) {
+            return true;
+        }
+        lastX = xs[j - 2*step];
+        lastY = ys[j - 2*step];
+        changes.push_back({j, lastX, lastY});
+    }
+
+    // The whole chain moved. Pulling the other end back would stop as soon
+    // as it reached a residue already in place, so there is no way back.
+    changes.clear();
+    return false;
+}
+
+// Whether pulling back from the far end of the pull in changes puts every
+// residue back where it was. Usually it does, but pulling back stops as soon
+// as a residue is already next to where the one before it goes, which can
+// happen earlier than on the way out. Random moves skip those pulls, so
+// every move they make has exactly one move undoing it.
+bool LatticeChain::pullReversible() {
+    if(changes.size() < 2) {
+        return true;
+    }
+
+    swapPositions();
+    // changes now hold the old positions, from the pulled residue to the last one that followed
+    pulledFrom = changes;
+    int first = pulledFrom.front().site;
+    int last = pulledFrom.back().site;
+    int step = pulledFrom[1].site - first;
+
+    bool reversible = false;
+    if(last == 0 || last == length-1) {
+        // Back with an end pull: last two spots out, its neighbour to the spot between
+        static const int dx[4] = {1, -1, 0, 0};
+        static const int dy[4] = {0, 0, 1, -1};
+        const siteMove &lastOld = pulledFrom.back();
+        const siteMove &nextOld = pulledFrom[pulledFrom.size() - 2];
+        int towardsC = -1;
+        int towardsL = -1;
+        for(int k=0;k<4;k++) {
+            if(xs[last] + dx[k] == nextOld.x && ys[last] + dy[k] == nextOld.y) {
+                towardsC = k;
+            }
+            if(nextOld.x + dx[k] == lastOld.x && nextOld.y + dy[k] == lastOld.y) {
+                towardsL = k;
+            }
+        }
+        reversible = towardsC >= 0 && towardsL >= 0 && buildEndPull(last, towardsC, towardsL) && changesRestore(first);
+    } else {
+        // Back with a pull of last towards the residue after it that stayed
+        for(int side=-1;side<=1 && !reversible;side+=2) {
+            reversible = buildPull(last, step, side) && changesRestore(first);
+        }
+    }
+
+    changes = pulledFrom;
+    swapPositions();
+    return reversible;
+}
+
+// Whether changes move every residue of pulledFrom (which starts at first) back to its old spot
+bool LatticeChain::changesRestore(int first) const {
+    if(changes.size() != pulledFrom.size()) {
+        return false;
+    }
+    for(size_t c=0;c<changes.size();c++) {
+        const siteMove &old = pulledFrom[abs(changes[c].site - first)];
+        if(old.site != changes[c].site || old.x != changes[c].x || old.y != changes[c].y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int LatticeChain::tryPull(int i, int step, int &movesLeft) {
+    for(int side=-1;side<=1 && movesLeft>0;side+=2) {
+        if(!buildPull(i, step, side)) {
+            continue;
+        }
+        int fitnessChange = tryMove(movesLeft);
+        if(fitnessChange < 0) {
+            return fitnessChange;
+        }
+    }
+    return 0;
+}
+
+int LatticeChain::improveAt(int i, int &movesLeft) {
+    static const int dx[4] = {1, -1, 0, 0};
+    static const int dy[4] = {0, 0, 1, -1};
+    int fitnessChange;
+
+    // End moves
+    if(i == 0 || i == length-1) {
+        int neighbour = i == 0 ? 1 : length-2;
+        for(int k=0;k<4 && movesLeft>0;k++) {
+            int x = xs[neighbour] + dx[k];
+            int y = ys[neighbour] + dy[k];
+            if(!isFree(x, y)) {
+                continue;
+            }
+            changes.clear();
+            changes.push_back({i, x, y});
+            if((fitnessChange = tryMove(movesLeft)) < 0) {
+                return fitnessChange;
+            }
+        }
+    }
+
+    if(i > 0 && i < length-1 && movesLeft > 0) {
+        // Corner flip
+        if(abs(xs[i-1] - xs[i+1]) == 1 && abs(ys[i-1] - ys[i+1]) == 1) {
+            int x = xs[i-1] + xs[i+1] - xs[i];
+            int y = ys[i-1] + ys[i+1] - ys[i];
+            if(isFree(x, y)) {
+                changes.clear();
+                changes.push_back({i, x, y});
+                if((fitnessChange = tryMove(movesLeft)) < 0) {
+                    return fitnessChange;
+                }
+            }
+        }
+
+        // Crankshaft of i and i+1
+        if(i+2 < length && movesLeft > 0 && abs(xs[i-1] - xs[i+2]) + abs(ys[i-1] - ys[i+2]) == 1 &&
+           xs[i] - xs[i-1] == xs[i+1] - xs[i+2] && ys[i] - ys[i-1] == ys[i+1] - ys[i+2]) {
+            int x1 = 2*xs[i-1] - xs[i];
+            int y1 = 2*ys[i-1] - ys[i];
+            int x2 = 2*xs[i+2] - xs[i+1];
+            int y2 = 2*ys[i+2] - ys[i+1];
+            if(isFree(x1, y1) && isFree(x2, y2)) {
+                changes.clear();
+                changes.push_back({i, x1, y1});
+                changes.push_back({i+1, x2, y2});
+                if((fitnessChange = tryMove(movesLeft)) < 0) {
+                    return fitnessChange;
+                }
+            }
+        }
+    }
+
+    // Pull moves in both directions along the chain
+    if(movesLeft > 0 && (fitnessChange = tryPull(i, 1, movesLeft)) < 0) {
+        return fitnessChange;
+    }
+    if(movesLeft > 0 && (fitnessChange = tryPull(i, -1, movesLeft)) < 0) {
+        return fitnessChange;
+    }
+    return 0;
+}
+
+bool LatticeChain::randomMoveAt(int i, int &fitnessChange) {
+    static const int dx[4] = {1, -1, 0, 0};
+    static const int dy[4] = {0, 0, 1, -1};
+    changes.clear();
+
+    if(length < 2) {
+        return false;
+    }
+    if(i == 0 || i == length-1) {
+        if(foldRand() % 2 == 0) {
+            // End move to one of the four spots around the neighbour
+            int neighbour = i == 0 ? 1 : length-2;
+            int k = foldRand() % 4;
+            int x = xs[neighbour] + dx[k];
+            int y = ys[neighbour] + dy[k];
+            if(!isFree(x, y)) {
+                return false;
+            }
+            changes.push_back({i, x, y});
+        } else if(!buildEndPull(i, foldRand() % 4, foldRand() % 4) || !pullReversible()) {
+            changes.clear();
+            return false;
+        }
+    } else {
+        int kind = foldRand() % 3;
+        if(kind == 0) {
+            // Corner flip
+            if(abs(xs[i-1] - xs[i+1]) != 1 || abs(ys[i-1] - ys[i+1]) != 1) {
+                return false;
+            }
+            int x = xs[i-1] + xs[i+1] - xs[i];
+            int y = ys[i-1] + ys[i+1] - ys[i];
+            if(!isFree(x, y)) {
+                return false;
+            }
+            changes.push_back({i, x, y});
+        } else if(kind == 1) {
+            // Crankshaft of i and i+1
+            if(i+2 >= length || abs(xs[i-1] - xs[i+2]) + abs(ys[i-1] - ys[i+2]) != 1 ||
+               xs[i] - xs[i-1] != xs[i+1] - xs[i+2] || ys[i] - ys[i-1] != ys[i+1] - ys[i+2]) {
+                return false;
+            }
+            int x1 = 2*xs[i-1] - xs[i];
+            int y1 = 2*ys[i-1] - ys[i];
+            int x2 = 2*xs[i+2] - xs[i+1];
+            int y2 = 2*ys[i+2] - ys[i+1];
+            if(!isFree(x1, y1) || !isFree(x2, y2)) {
+                return false;
+            }
+            changes.push_back({i, x1, y1});
+            changes.push_back({i+1, x2, y2});
+        } else {
+            // Pull in either direction along the chain, to either side
+            int step = foldRand() % 2 ? 1 : -1;
+            int side = foldRand() % 2 ? 1 : -1;
+            if(!buildPull(i, step, side) || !pullReversible()) {
+                changes.clear();
+                return false;
+            }
+
+            // A pull that drags the chain all the way to its end is undone by
+            // an end pull, which is drawn with 3/8 of the chance (1/2 * 1/16
+            // against 1/3 * 1/2 * 1/2). Turning down the rest keeps the moves
+            // balanced, so accepting them all samples every fold equally.
+            int last = changes.back().site;
+            if((last == 0 || last == length-1) && foldRand() % 8 >= 3) {
+                changes.clear();
+                return false;
+            }
+        }
+    }
+
+    fitnessChange = applyMove();
+    return true;
+}
+
+string LatticeChain::getDirections() const {
+    string proteinDirection(length, '0');
+    for(int i=0;i<length-1;i++) {
+        int dx = xs[i+1] - xs[i];
+        int dy = ys[i+1] - ys[i];
+        if(dy < 0) {
+            proteinDirection[i] = '1';
+        } else if(dx > 0) {
+            proteinDirection[i] = '2';
+        } else if(dy > 0) {
+            proteinDirection[i] = '3';
+        } else {
+            proteinDirection[i] = '4';
+        }
+    }
+    return proteinDirection;
+}
+
+
+int polishFold(const contactIndex &hIndex, string &proteinDirection, int fitness, int maxMoves) {
+    int length = hIndex.length;
+    if(length < 2 || maxMoves <= 0) {
+        return fitness;
+    }
+
+    LatticeChain search(hIndex, proteinDirection);
+    int movesLeft = maxMoves;
+    bool improved = true;
+    while(improved && movesLeft > 0) {
+        improved = false;
+        // Start each pass somewhere else so the budget is not always spent on the same end
+        int start = foldRand() % length;
+        for(int k=0;k<length && movesLeft>0;k++) {
+            int fitnessChange = search.improveAt((start + k) % length, movesLeft);
+            if(fitnessChange < 0) {
+                fitness += fitnessChange;
+                improved = true;
+            }
+        }
+    }
+
+    proteinDirection = search.getDirections();
+    return fitness;
+}
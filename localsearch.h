@@ -0,0 +1,84 @@
+#ifndef LOCALSEARCH_H
+#define LOCALSEARCH_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "contactindex.h"
+
+// A fold as residue positions plus a position -> residue map, changed with
+// the classic lattice moves:
+//   end moves     the first or last residue jumps to a free spot next to its neighbour
+//   corner flips  a residue on an L turn flips to the opposite corner
+//   crankshafts   two residues on a U turn flip to the other side
+//   pull moves    a residue is pulled to a free diagonal spot and the chain
+//                 behind it follows along its old path until it reconnects
+//                 (random moves also pull the ends two spots out, so every
+//                 pull can be undone)
+// Each move is scored from the contacts of the residues it moved only.
+class LatticeChain
+{
+public:
+    LatticeChain(const contactIndex &hIndex, const std::string &proteinDirection);
+
+    // Tries the moves at residue i until one improves, returns the fitness change (0 if none did)
+    int improveAt(int i, int &movesLeft);
+
+    // Makes one random move at residue i and sets its fitness change, false
+    // (and nothing moved) if the move drawn is not possible there. The move
+    // stays until the next one unless it is undone with undoMove(). Moves are
+    // drawn so that going from one fold to another is as likely as going
+    // back, so Metropolis-style acceptance needs no correction.
+    bool randomMoveAt(int i, int &fitnessChange);
+    void undoMove();
+
+    int size() const { return length; }
+    std::string getDirections() const;
+
+private:
+    struct siteMove {
+        int site;
+        int x, y;
+    };
+
+    bool isFree(int x, int y) const {
+        return occupied.find(packCoordinate(x, y)) == occupied.end();
+    }
+    int siteAt(int x, int y) const {
+        std::unordered_map<uint64_t, int>::const_iterator it = occupied.find(packCoordinate(x, y));
+        return it == occupied.end() ? -1 : it->second;
+    }
+
+    int energyOf(int site) const;
+    int applyMove();
+    void swapPositions();
+    int tryMove(int &movesLeft);
+    int tryPull(int i, int step, int &movesLeft);
+    bool buildPull(int i, int step, int side);
+    bool buildEndPull(int i, int towardsC, int towardsL);
+    bool pullReversible();
+    bool changesRestore(int first) const;
+
+    const contactIndex &hIndex;
+    int length;
+    std::vector<int> xs;
+    std::vector<int> ys;
+    std::vector<char> moved;
+    std::unordered_map<uint64_t, int> occupied;
+
+    // The move being tried, or the last one made (with the old positions)
+    std::vector<siteMove> changes;
+    // Scratch copy of a pull for pullReversible()
+    std::vector<siteMove> pulledFrom;
+};
+
+// First-improvement local search on one fold with the moves above: the
+// first one that improves the fitness is kept. Stops when a full pass finds
+// nothing better or after maxMoves tried moves.
+//
+// proteinDirection is updated in place, returns the new fitness.
+int polishFold(const contactIndex &hIndex, std::string &proteinDirection, int fitness, int maxMoves);
+
+#endif // LOCALSEARCH_H
@@ -1,15 +1,69 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "proteinrenderer.h"
 
-MainWindow::MainWindow(QWidget *parent) :
+#include <QApplication>
+#include <QStatusBar>
+
+// About 30 polls a second, painting never runs more often than that
+static const int pollMilliseconds = 33;
+
+MainWindow::MainWindow(SearchWorker *worker, int maxFitnessLimit, int pixelSpacing, QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::MainWindow)
+    ui(new Ui::MainWindow),
+    worker(worker),
+    maxFitnessLimit(maxFitnessLimit),
+    pixelSpacing(pixelSpacing)
 {
     this->setFixedSize(800,600);
     ui->setupUi(this);
+
+    picture = new QLabel(this);
+    picture->setAlignment(Qt::AlignCenter);
+    setCentralWidget(picture);
+
+    // Child label for displaying the fitness level, made once and only retexted
+    fitnessLabel = new QLabel(picture);
+    QFont f("Arial", 16, QFont::Bold);
+    fitnessLabel->setMargin(10);
+    fitnessLabel->setFont(f);
+    fitnessLabel->setAlignment(Qt::AlignTop);
+    fitnessLabel->setText("Loading...");
+    fitnessLabel->show();
+
+    connect(&pollTimer, SIGNAL(timeout()), this, SLOT(pollSnapshot()));
+    pollTimer.start(pollMilliseconds);
 }
 
 MainWindow::~MainWindow()
 {
     delete ui;
 }
+
+void MainWindow::pollSnapshot() {
+    SnapshotSlot<searchSnapshot> &slot = worker->snapshots();
+    if(!slot.update()) {
+        return;
+    }
+    const searchSnapshot &snapshot = slot.front();
+
+    // Every test case is done, same as the old loop running out
+    if(snapshot.finished) {
+        pollTimer.stop();
+        qApp->quit();
+        return;
+    }
+
+    if(snapshot.proteinDirection != shownDirection || snapshot.proteinSequence != shownSequence) {
+        shownSequence = snapshot.proteinSequence;
+        shownDirection = snapshot.proteinDirection;
+        picture->setPicture(drawProtein(shownSequence, shownDirection, maxFitnessLimit, pixelSpacing));
+    }
+
+    std::string fitText = "Fitness: " + std::to_string(snapshot.fitness);
+    fitnessLabel->setText(QString::fromStdString(fitText));
+    fitnessLabel->adjustSize();
+
+    std::string statusText = "Generation: " + std::to_string(snapshot.generation) + "   Target: " + std::to_string(snapshot.targetFitness) + "   Done: " + std::to_string(snapshot.numCompleted);
+    ui->statusBar->showMessage(QString::fromStdString(statusText));
+}
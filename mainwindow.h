@@ -2,21 +2,45 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QLabel>
+#include <QTimer>
+
+#include <string>
+
+#include "searchworker.h"
 
 namespace Ui {
 class MainWindow;
 }
 
+// Shows the fold the search worker published last. The worker never waits
+// for the window: a timer picks up the newest snapshot, and the picture is
+// only redrawn when the fold actually changed.
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget *parent = 0);
+    explicit MainWindow(SearchWorker *worker, int maxFitnessLimit, int pixelSpacing, QWidget *parent = 0);
     ~MainWindow();
 
+private slots:
+    void pollSnapshot();
+
 private:
     Ui::MainWindow *ui;
+
+    SearchWorker *worker;
+    int maxFitnessLimit;
+    int pixelSpacing;
+
+    QLabel *picture;
+    QLabel *fitnessLabel;
+    QTimer pollTimer;
+
+    // What the picture shows now
+    std::string shownSequence;
+    std::string shownDirection;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,289 @@
+#include "memorybudget.h"
+
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#ifdef FOLDING_TRACK_ALLOCATIONS
+#include <new>
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+
+#ifdef FOLDING_TRACK_ALLOCATIONS
+
+// Plain thread_locals, operator new runs before anything could construct them
+static thread_local uint64_t threadAllocationCount;
+static thread_local uint64_t threadAllocationBytes;
+static atomic<int64_t> heapLive(0);
+static atomic<int64_t> heapPeak(0);
+
+// Counts the usable size on both ends, so frees balance without a size header
+static void *trackedAlloc(size_t size) {
+    void *pointer = malloc(size == 0 ? 1 : size);
+    if(pointer == NULL) {
+        return NULL;
+    }
+
+    size_t usable = malloc_usable_size(pointer);
+    threadAllocationCount++;
+    threadAllocationBytes += usable;
+    int64_t live = heapLive.fetch_add(usable, memory_order_relaxed) + usable;
+    int64_t peak = heapPeak.load(memory_order_relaxed);
+    while(live > peak && !heapPeak.compare_exchange_weak(peak, live, memory_order_relaxed)) {
+    }
+    return pointer;
+}
+
+static void trackedFree(void *pointer) {
+    if(pointer == NULL) {
+        return;
+    }
+    heapLive.fetch_sub(malloc_usable_size(pointer), memory_order_relaxed);
+    free(pointer);
+}
+
+void *operator new(size_t size) {
+    void *pointer = trackedAlloc(size);
+    if(pointer == NULL) {
+        throw bad_alloc();
+    }
+    return pointer;
+}
+void *operator new[](size_t size) {
+    void *pointer = trackedAlloc(size);
+    if(pointer == NULL) {
+        throw bad_alloc();
+    }
+    return pointer;
+}
+void *operator new(size_t size, const nothrow_t &) noexcept {
+    return trackedAlloc(size);
+}
+void *operator new[](size_t size, const nothrow_t &) noexcept {
+    return trackedAlloc(size);
+}
+void operator delete(void *pointer) noexcept {
+    trackedFree(pointer);
+}
+void operator delete[](void *pointer) noexcept {
+    trackedFree(pointer);
+}
+void operator delete(void *pointer, size_t) noexcept {
+    trackedFree(pointer);
+}
+void operator delete[](void *pointer, size_t) noexcept {
+    trackedFree(pointer);
+}
+void operator delete(void *pointer, const nothrow_t &) noexcept {
+    trackedFree(pointer);
+}
+void operator delete[](void *pointer, const nothrow_t &) noexcept {
+    trackedFree(pointer);
+}
+
+bool allocationTracking() {
+    return true;
+}
+
+void threadAllocations(uint64_t &allocations, uint64_t &bytes) {
+    allocations = threadAllocationCount;
+    bytes = threadAllocationBytes;
+}
+
+uint64_t liveHeapBytes() {
+    return max<int64_t>(0, heapLive.load(memory_order_relaxed));
+}
+
+uint64_t peakHeapBytes() {
+    return max<int64_t>(0, heapPeak.load(memory_order_relaxed));
+}
+
+#else
+
+bool allocationTracking() {
+    return false;
+}
+
+void threadAllocations(uint64_t &allocations, uint64_t &bytes) {
+    allocations = 0;
+    bytes = 0;
+}
+
+uint64_t liveHeapBytes() {
+    return 0;
+}
+
+uint64_t peakHeapBytes() {
+    return 0;
+}
+
+#endif // FOLDING_TRACK_ALLOCATIONS
+
+
+uint64_t residentBytes() {
+    // Second field of statm is the resident set in pages
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if(statm == NULL) {
+        return 0;
+    }
+    unsigned long long size = 0, resident = 0;
+    if(fscanf(statm, "%llu %llu", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(statm);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+uint64_t peakResidentBytes() {
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) < 0) {
+        return 0;
+    }
+    // Kilobytes on Linux
+    return (uint64_t)usage.ru_maxrss * 1024;
+}
+
+static string megabytes(uint64_t bytes) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.1f MB", bytes / 1048576.0);
+    return text;
+}
+
+string formatMemory() {
+    string text = "Memory: resident " + megabytes(residentBytes()) + " (peak " + megabytes(peakResidentBytes()) + ")";
+    if(allocationTracking()) {
+        text += ", heap " + megabytes(liveHeapBytes()) + " (peak " + megabytes(peakHeapBytes()) + ")";
+    }
+    if(memoryGate().getBudget() > 0) {
+        text += ", budget " + megabytes(memoryGate().getBudget());
+    }
+    return text;
+}
+
+
+size_t estimateSearchBytes(const string &engineName, int length, const foldingOptions &options) {
+    // A fold as the operators hold it: the node, its string and the allocator's overhead
+    size_t foldBytes = sizeof(proteinNode) + (length + 16) / 16 * 16 + 16;
+    // collisionDetection and createRandomSequence build a (2*limit+3)^2 grid of ints, row by row
+    size_t side = 2 * (size_t)max(options.maxFitnessLimit, 1) + 3;
+    size_t gridBytes = side * (side * sizeof(int) + 32);
+    // Contact index and the per-thread scoring table
+    size_t indexBytes = (size_t)length * 96;
+    int popNum = max(2, options.popNum);
+
+    if(engineName == "steady") {
+        // Population plus the set of folds already in it
+        return popNum * (2 * foldBytes + 32) + gridBytes + indexBytes;
+    } else if(engineName == "replica") {
+        size_t numReplicas = options.reReplicas > 0 ? options.reReplicas : max(2u, thread::hardware_concurrency());
+        return numReplicas * (4 * foldBytes + gridBytes + indexBytes);
+    } else if(engineName == "pivot") {
+        // Two SAW-tree nodes per site, about 128 bytes each
+        return (size_t)length * 256 + 4 * foldBytes + gridBytes + indexBytes;
+    } else if(engineName == "wanglandau") {
+        // Per window: an occupancy map of the chain, ln g and histogram for up to 2 contacts a residue, the kept folds
+        size_t numWindows = options.wlWindows > 0 ? options.wlWindows : max(1u, thread::hardware_concurrency());
+        size_t windowBytes = (size_t)length * 64 + (size_t)length * 2 * 17 + max(options.wlKeepFolds, 1) * foldBytes;
+        return numWindows * (windowBytes + gridBytes) + indexBytes;
+    } else if(engineName == "aco") {
+        // Per worker a lattice of ints (2*length+1 square) and the backtracking state, per ant its fold and turns
+        size_t numWorkers = min(max(options.acoAnts, 1), engineThreadCount(options));
+        size_t side = 2 * (size_t)length + 1;
+        size_t workerBytes = side * side * sizeof(int) + (size_t)length * 16 + (size_t)max(options.acoElites, 1) * length * 64;
+        size_t antBytes = foldBytes + (size_t)length + 96;
+        return numWorkers * workerBytes + max(options.acoAnts, 1) * antBytes + (size_t)length * 24 + gridBytes + indexBytes;
+    }
+
+    // GA: two populations, the copy grabParent takes of one, and the memetic threads' occupancy maps
+    size_t memeticBytes = (size_t)max(options.memeticElites, 0) * length * 64;
+    // Niching reorders into a third population and packs every fold's turns
+    size_t nicheBytes = options.niching != "none" ? popNum * (foldBytes + (length + 31) / 32 * 8 + 24) : 0;
+    size_t gaBytes = 3 * popNum * foldBytes + gridBytes + indexBytes + memeticBytes + nicheBytes;
+    // Restarts run whole GAs of their own next to it, plus the merged population
+    size_t restartBytes = options.apocalypse == 1 ? max(options.apocSubPopulations, 1) * gaBytes + 2 * popNum * foldBytes : 0;
+    return gaBytes + restartBytes;
+}
+
+
+MemoryGate::MemoryGate() :
+    budget(0),
+    baseline(0),
+    reserved(0),
+    numAdmitted(0),
+    numHeldBack(0)
+{
+}
+
+void MemoryGate::setBudget(uint64_t bytes) {
+    lock_guard<mutex> guard(lock);
+    budget = bytes;
+    baseline = bytes > 0 ? residentBytes() : 0;
+    released.notify_all();
+}
+
+uint64_t MemoryGate::getBudget() const {
+    lock_guard<mutex> guard(lock);
+    return budget;
+}
+
+bool MemoryGate::fits(size_t jobBytes) const {
+    return budget == 0 || numAdmitted == 0 || baseline + reserved + jobBytes <= budget;
+}
+
+bool MemoryGate::tryAcquire(size_t jobBytes) {
+    lock_guard<mutex> guard(lock);
+    if(!fits(jobBytes)) {
+        numHeldBack++;
+        return false;
+    }
+    reserved += jobBytes;
+    numAdmitted++;
+    return true;
+}
+
+void MemoryGate::acquire(size_t jobBytes) {
+    unique_lock<mutex> guard(lock);
+    if(!fits(jobBytes)) {
+        numHeldBack++;
+        released.wait(guard, [this, jobBytes] { return fits(jobBytes); });
+    }
+    reserved += jobBytes;
+    numAdmitted++;
+}
+
+void MemoryGate::release(size_t jobBytes) {
+    {
+        lock_guard<mutex> guard(lock);
+        reserved -= min<uint64_t>(reserved, jobBytes);
+        numAdmitted--;
+    }
+    released.notify_all();
+}
+
+int MemoryGate::fitConcurrency(size_t jobBytes, int requested) const {
+    lock_guard<mutex> guard(lock);
+    if(budget == 0 || jobBytes == 0) {
+        return requested;
+    }
+    uint64_t room = budget > baseline ? budget - baseline : 0;
+    return max(1, (int)min<uint64_t>(requested, room / jobBytes));
+}
+
+long MemoryGate::getNumHeldBack() const {
+    lock_guard<mutex> guard(lock);
+    return numHeldBack;
+}
+
+
+MemoryGate &memoryGate() {
+    static MemoryGate gate;
+    return gate;
+}
@@ -0,0 +1,77 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+
+#include "foldingengine.h"
+
+// Memory accounting and the process-wide memory budget.
+//
+// Allocation counting replaces the global operator new/delete and is only
+// compiled into diagnostic builds (qmake CONFIG+=alloctrack, which defines
+// FOLDING_TRACK_ALLOCATIONS). It counts per thread, so the kernel probes in
+// perfcounters.h can report allocations per kernel and per generation.
+// Resident memory is read from the OS in every build.
+
+bool allocationTracking();
+
+// Allocations and bytes made by the calling thread so far, 0 without tracking
+void threadAllocations(uint64_t &allocations, uint64_t &bytes);
+
+// Heap bytes in use now and at most so far, 0 without tracking
+uint64_t liveHeapBytes();
+uint64_t peakHeapBytes();
+
+uint64_t residentBytes();
+uint64_t peakResidentBytes();
+
+// "Memory: resident X MB (peak Y MB), heap ..." for the logs
+std::string formatMemory();
+
+
+// Rough footprint of one search with these options: its population (or
+// replicas, or SAW-tree), the collision grids of the operators and scoring scratch
+size_t estimateSearchBytes(const std::string &engineName, int length, const foldingOptions &options);
+
+// Admits searches while their estimated footprints fit in the budget, so
+// schedulers run fewer searches at once instead of running out of memory.
+// One search is always let in when none are running, however big it is.
+class MemoryGate
+{
+public:
+    MemoryGate();
+
+    // 0 for no budget. What the process uses when this is called counts against it.
+    void setBudget(uint64_t bytes);
+    uint64_t getBudget() const;
+
+    bool tryAcquire(size_t jobBytes);
+    // Waits for running searches to release until the job fits
+    void acquire(size_t jobBytes);
+    void release(size_t jobBytes);
+
+    // How many jobs of jobBytes fit at once, at least 1 and at most requested
+    int fitConcurrency(size_t jobBytes, int requested) const;
+
+    // Times a job had to wait or was turned away
+    long getNumHeldBack() const;
+
+private:
+    bool fits(size_t jobBytes) const;
+
+    mutable std::mutex lock;
+    std::condition_variable released;
+    uint64_t budget;
+    uint64_t baseline;
+    uint64_t reserved;
+    int numAdmitted;
+    long numHeldBack;
+};
+
+MemoryGate &memoryGate();
+
+#endif // MEMORYBUDGET_H
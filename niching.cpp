@@ -0,0 +1,137 @@
+#include "niching.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+void NicheRanker::pack(const vector<proteinNode> &population) {
+    numFolds = population.size();
+    int length = numFolds > 0 ? population[0].proteinDirection.size() : 0;
+    // A turn between every two steps, the last direction is the 0 at the end
+    int numTurns = max(length - 2, 0);
+    wordsPerFold = max((numTurns + 31) / 32, 1);
+    words.assign((size_t)numFolds * wordsPerFold, 0);
+
+    for(int i=0;i<numFolds;i++) {
+        const string &dirs = population[i].proteinDirection;
+        uint64_t *fold = &words[(size_t)i * wordsPerFold];
+        for(int t=0;t<numTurns;t++) {
+            // 0 straight, 1 right, 3 left (2 would walk back onto the chain)
+            uint64_t turn = (dirs[t+1] - dirs[t] + 4) & 3;
+            fold[t / 32] |= turn << (2 * (t % 32));
+        }
+    }
+}
+
+
+static inline int turnsApart(const uint64_t *a, const uint64_t *b, int numWords) {
+    int differ = 0;
+    for(int w=0;w<numWords;w++) {
+        uint64_t x = a[w] ^ b[w];
+        // One bit per turn that differs in either of its two bits
+        differ += __builtin_popcountll((x | (x >> 1)) & 0x5555555555555555ULL);
+    }
+    return differ;
+}
+
+int NicheRanker::distance(int a, int b) const {
+    return turnsApart(&words[(size_t)a * wordsPerFold], &words[(size_t)b * wordsPerFold], wordsPerFold);
+}
+
+void NicheRanker::distancesFrom(int from, int first, int last, vector<int> &distances) const {
+    distances.resize(numFolds);
+    const uint64_t *a = &words[(size_t)from * wordsPerFold];
+    const uint64_t *b = &words[(size_t)first * wordsPerFold];
+    for(int j=first;j<last;j++) {
+        distances[j] = turnsApart(a, b, wordsPerFold);
+        b += wordsPerFold;
+    }
+}
+
+
+int NicheRanker::clear(vector<proteinNode> &sorted, int radius, int capacity) {
+    pack(sorted);
+    cleared.assign(numFolds, 0);
+    inNiche.assign(numFolds, 0);
+
+    int numNiches = 0;
+    for(int i=0;i<numFolds;i++) {
+        if(inNiche[i]) {
+            continue;
+        }
+        inNiche[i] = 1;
+        numNiches++;
+
+        int members = 1;
+        distancesFrom(i, i + 1, numFolds, nicheDistances);
+        for(int j=i+1;j<numFolds;j++) {
+            if(inNiche[j] || nicheDistances[j] > radius) {
+                continue;
+            }
+            inNiche[j] = 1;
+            if(members < capacity) {
+                members++;
+            } else {
+                cleared[j] = 1;
+            }
+        }
+    }
+
+    // Stable, so the winners (and the best fold first) keep their fitness order
+    reordered.clear();
+    for(int pass=0;pass<2;pass++) {
+        for(int i=0;i<numFolds;i++) {
+            if(cleared[i] == pass) {
+                reordered.push_back(sorted[i]);
+            }
+        }
+    }
+    sorted.swap(reordered);
+
+    return numNiches;
+}
+
+
+int NicheRanker::share(vector<proteinNode> &sorted, int radius) {
+    pack(sorted);
+    double sigma = radius + 1;
+
+    // Distances are symmetric, each pair is measured once
+    nicheCounts.assign(numFolds, 1.0);
+    for(int i=0;i<numFolds;i++) {
+        distancesFrom(i, i + 1, numFolds, nicheDistances);
+        for(int j=i+1;j<numFolds;j++) {
+            if(nicheDistances[j] <= radius) {
+                double shared = 1.0 - nicheDistances[j] / sigma;
+                nicheCounts[i] += shared;
+                nicheCounts[j] += shared;
+            }
+        }
+    }
+
+    double effectiveNiches = 0;
+    for(int i=0;i<numFolds;i++) {
+        effectiveNiches += 1.0 / nicheCounts[i];
+    }
+
+    // The best fold stays in front, whatever its niche, so best() is still the best
+    order.resize(numFolds);
+    for(int i=0;i<numFolds;i++) {
+        order[i] = i;
+    }
+    if(numFolds > 1) {
+        stable_sort(order.begin() + 1, order.end(), [&](int a, int b) {
+            return sorted[a].fitness / nicheCounts[a] < sorted[b].fitness / nicheCounts[b];
+        });
+    }
+
+    reordered.clear();
+    for(int i=0;i<numFolds;i++) {
+        reordered.push_back(sorted[order[i]]);
+    }
+    sorted.swap(reordered);
+
+    return (int)lround(effectiveNiches);
+}
@@ -0,0 +1,56 @@
+#ifndef NICHING_H
+#define NICHING_H
+
+#include <vector>
+#include <cstdint>
+
+#include "folding.h"
+
+// Niching for the GA: keeps a population from collapsing onto near-copies of
+// one fold by ranking folds against the others close to them.
+//
+// Folds are compared by their turns (straight, left, right) instead of their
+// directions, so a fold and its rotation are the same and a corner flip in
+// the middle of the chain differs in two places rather than in the whole
+// tail. The turns are packed two bits a residue, 32 to a word, and the
+// distance of two folds is the number of turns that differ, a popcount per
+// word. All folds of a population sit in one buffer, so the distances from
+// one fold to the rest are a single pass over contiguous memory.
+class NicheRanker
+{
+public:
+    // Packs the folds, all of the same length
+    void pack(const std::vector<proteinNode> &population);
+
+    // Turns that differ between fold a and b
+    int distance(int a, int b) const;
+    // distances[j] = distance(from, j) for j in [first, last)
+    void distancesFrom(int from, int first, int last, std::vector<int> &distances) const;
+
+    // Clearing: walking down a population sorted by fitness, every fold not
+    // yet in a niche starts one and the next capacity - 1 folds within radius
+    // turns of it join it, the rest within radius are cleared. Winners keep
+    // their order at the front, cleared folds go behind them. Returns the
+    // number of niches.
+    int clear(std::vector<proteinNode> &sorted, int radius, int capacity);
+
+    // Fitness sharing: every fold's fitness is divided by its niche count,
+    // the sum of 1 - d/(radius+1) over the folds within radius turns of it
+    // (itself included), and all but the best are reordered by that shared
+    // fitness. Returns the effective number of niches, the sum of 1 / count.
+    int share(std::vector<proteinNode> &sorted, int radius);
+
+private:
+    int numFolds;
+    int wordsPerFold;
+    std::vector<uint64_t> words;
+
+    std::vector<int> nicheDistances;
+    std::vector<char> inNiche;
+    std::vector<char> cleared;
+    std::vector<double> nicheCounts;
+    std::vector<int> order;
+    std::vector<proteinNode> reordered;
+};
+
+#endif // NICHING_H
@@ -0,0 +1,104 @@
+#include "operatorcontrol.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+
+
+const char *operatorName(int op) {
+    static const char *names[numGeneticOperators] = { "crossover", "mutate", "random" };
+    return op >= 0 && op < numGeneticOperators ? names[op] : "unknown";
+}
+
+
+OperatorController::OperatorController() :
+    decay(0.95),
+    minShare(0.05),
+    numShifts(0)
+{
+    for(int op=0;op<numGeneticOperators;op++) {
+        baseShares[op] = 1.0 / numGeneticOperators;
+        stats[op] = operatorStats();
+        stats[op].share = baseShares[op];
+        pendingCalls[op] = 0;
+        pendingSuccesses[op] = 0;
+        pendingGain[op] = 0;
+        pendingSeconds[op] = 0;
+    }
+}
+
+void OperatorController::configure(const double shares[numGeneticOperators], int window, double minimum) {
+    double total = 0;
+    for(int op=0;op<numGeneticOperators;op++) {
+        total += max(shares[op], 0.0);
+    }
+    // Every operator keeps enough to be measured, which caps the minimum at an even split
+    minShare = min(max(minimum, 0.0), 1.0 / numGeneticOperators);
+    for(int op=0;op<numGeneticOperators;op++) {
+        double share = total > 0 ? max(shares[op], 0.0) / total : 1.0 / numGeneticOperators;
+        baseShares[op] = minShare + (1.0 - numGeneticOperators * minShare) * share;
+        stats[op].share = baseShares[op];
+    }
+    decay = 1.0 - 1.0 / max(window, 1);
+}
+
+
+void OperatorController::record(int op, int calls, int successes, int gain, double seconds) {
+    pendingCalls[op] += calls;
+    pendingSuccesses[op] += successes;
+    pendingGain[op] += max(gain, 0);
+    pendingSeconds[op] += seconds;
+    stats[op].totalCalls += calls;
+    stats[op].totalSuccesses += successes;
+}
+
+void OperatorController::update() {
+    double rates[numGeneticOperators];
+    double totalRate = 0;
+    for(int op=0;op<numGeneticOperators;op++) {
+        operatorStats &s = stats[op];
+        s.calls = s.calls * decay + pendingCalls[op];
+        s.successes = s.successes * decay + pendingSuccesses[op];
+        s.gain = s.gain * decay + pendingGain[op];
+        s.seconds = s.seconds * decay + pendingSeconds[op];
+        pendingCalls[op] = 0;
+        pendingSuccesses[op] = 0;
+        pendingGain[op] = 0;
+        pendingSeconds[op] = 0;
+
+        rates[op] = s.seconds > 0 ? s.gain / s.seconds : 0;
+        totalRate += rates[op];
+    }
+
+    // Half stays on the configured shares: gains only measure the next few
+    // generations, and going all in on the best arm starves the others of the
+    // diversity they keep up
+    bool shifted = false;
+    for(int op=0;op<numGeneticOperators;op++) {
+        double share = baseShares[op];
+        if(totalRate > 0) {
+            share = 0.5 * baseShares[op] + 0.5 * (minShare + (1.0 - numGeneticOperators * minShare) * rates[op] / totalRate);
+        }
+        shifted = shifted || fabs(share - stats[op].share) > 0.01;
+        stats[op].share = share;
+    }
+    if(shifted) {
+        numShifts++;
+    }
+}
+
+
+string OperatorController::describe() const {
+    string text = "Operators:";
+    for(int op=0;op<numGeneticOperators;op++) {
+        const operatorStats &s = stats[op];
+        char part[96];
+        snprintf(part, sizeof(part), "  %s %.0f%% (ok %.0f%%, %.1f/s)", operatorName(op), 100 * s.share,
+                 s.calls > 0 ? 100 * s.successes / s.calls : 0.0, s.seconds > 0 ? s.gain / s.seconds : 0.0);
+        text += part;
+    }
+    text += "  shifts " + to_string(numShifts);
+    return text;
+}
@@ -0,0 +1,80 @@
+#ifndef OPERATORCONTROL_H
+#define OPERATORCONTROL_H
+
+#include <string>
+
+// Adaptive operator rates for the GA: decides how a generation's budget of
+// operator applications is shared between crossover, mutation and random
+// folds, from what each has paid off lately.
+//
+// The engine reports every application: the operator calls it took
+// (including the ones that came back "failed"), whether it produced a fold,
+// how much fitter that fold is than what it came from, and the time it took,
+// retries included. A fold only gains what it beats both its parent and the
+// weakest elite by. Gains and times are averaged exponentially over about
+// window generations.
+//
+// Each generation half of the budget follows the configured shares and the
+// other half is shared in proportion to gain per second, with at least
+// minShare per operator (probability matching, a bandit that never stops
+// measuring any arm). While nothing has gained anything lately the
+// configured shares get all of it.
+enum geneticOperator {
+    operatorCrossover,
+    operatorMutate,
+    operatorRandom,
+    numGeneticOperators
+};
+
+struct operatorStats {
+    // Fraction of the budget for the next generation
+    double share;
+
+    // Averaged over the window
+    double calls;
+    double successes;
+    double gain;
+    double seconds;
+
+    // Totals over the run
+    long totalCalls;
+    long totalSuccesses;
+};
+
+class OperatorController
+{
+public:
+    OperatorController();
+    // Starting shares (any scale), window in generations, share kept by every operator
+    void configure(const double baseShares[numGeneticOperators], int window, double minShare);
+
+    // One application of an operator: calls made, folds made, fitness gained (>= 0)
+    void record(int op, int calls, int successes, int gain, double seconds);
+    // Ends a generation: ages the averages and sets the shares for the next one
+    void update();
+
+    double getShare(int op) const { return stats[op].share; }
+    const operatorStats &getStats(int op) const { return stats[op]; }
+    // Times the shares moved by more than a percentage point at an update
+    int getNumShifts() const { return numShifts; }
+
+    // The shares and what they are based on, for the console
+    std::string describe() const;
+
+private:
+    operatorStats stats[numGeneticOperators];
+    double baseShares[numGeneticOperators];
+    // Running sums for the generation in progress
+    double pendingCalls[numGeneticOperators];
+    double pendingSuccesses[numGeneticOperators];
+    double pendingGain[numGeneticOperators];
+    double pendingSeconds[numGeneticOperators];
+
+    double decay;
+    double minShare;
+    int numShifts;
+};
+
+const char *operatorName(int op);
+
+#endif // OPERATORCONTROL_H
@@ -0,0 +1,327 @@
+#include "perfcounters.h"
+#include "memorybudget.h"
+
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+atomic<bool> profilingEnabled(false);
+
+static const char *kernelNames[numProfileKernels] = {
+    "fitness", "collision", "randomFold", "crossover", "mutate", "grabParent", "sort", "dedup"
+};
+
+static const char *counterNames[numProfileCounters] = {
+    "cycles", "instructions", "cache-misses", "branch-misses"
+};
+
+static const uint64_t counterConfigs[numProfileCounters] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+// Set by enableProfiling() before any probe runs
+static bool available[numProfileCounters];
+
+// calls, nanoseconds, allocations, allocated bytes, then the counters
+static const int numFields = 4 + numProfileCounters;
+
+
+static int openCounter(int counter, int groupFd) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = counterConfigs[counter];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    // This thread, any CPU
+    return syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC);
+}
+
+static inline uint64_t monotonicNanoseconds() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t readPmc(uint32_t counter) {
+    uint32_t low, high;
+    __asm__ volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(counter));
+    return ((uint64_t)high << 32) | low;
+}
+
+// User space read of a counter through its mmap page, false if the kernel does not allow it right now
+static bool readMapped(const perf_event_mmap_page *page, uint64_t &value) {
+    const volatile uint32_t *lock = &page->lock;
+    uint32_t sequence;
+    do {
+        sequence = *lock;
+        atomic_signal_fence(memory_order_seq_cst);
+
+        uint32_t index = page->index;
+        if(!page->cap_user_rdpmc || index == 0) {
+            return false;
+        }
+        int shift = 64 - page->pmc_width;
+        value = page->offset + ((int64_t)(readPmc(index - 1) << shift) >> shift);
+
+        atomic_signal_fence(memory_order_seq_cst);
+    } while(*lock != sequence);
+    return true;
+}
+#else
+static bool readMapped(const perf_event_mmap_page *page, uint64_t &value) {
+    (void)page;
+    (void)value;
+    return false;
+}
+#endif
+
+
+// One thread's counter group and its running totals. The owner is the only
+// writer, snapshots read the totals from other threads.
+class ThreadProfile
+{
+public:
+    ThreadProfile();
+    ~ThreadProfile();
+
+    void read(uint64_t counts[numProfileCounters]);
+    void add(int kernel, const profileSample &used);
+
+    atomic<uint64_t> totals[numProfileKernels][numFields];
+
+private:
+    int leaderFd;
+    int fds[numProfileCounters];
+    perf_event_mmap_page *pages[numProfileCounters];
+    // Counters in the order they joined the group, which is how read() returns them
+    vector<int> order;
+};
+
+static mutex registryMutex;
+static vector<ThreadProfile *> liveThreads;
+// Totals of threads that have exited
+static uint64_t retired[numProfileKernels][numFields];
+
+ThreadProfile::ThreadProfile() :
+    leaderFd(-1)
+{
+    for(int k=0;k<numProfileKernels;k++) {
+        for(int f=0;f<numFields;f++) {
+            totals[k][f].store(0, memory_order_relaxed);
+        }
+    }
+
+    long pageSize = sysconf(_SC_PAGESIZE);
+    for(int c=0;c<numProfileCounters;c++) {
+        fds[c] = -1;
+        pages[c] = NULL;
+        if(!available[c]) {
+            continue;
+        }
+
+        fds[c] = openCounter(c, leaderFd);
+        if(fds[c] < 0) {
+            continue;
+        }
+        if(leaderFd < 0) {
+            leaderFd = fds[c];
+        }
+        order.push_back(c);
+
+        void *mapped = mmap(NULL, pageSize, PROT_READ, MAP_SHARED, fds[c], 0);
+        pages[c] = mapped == MAP_FAILED ? NULL : (perf_event_mmap_page *)mapped;
+    }
+
+    lock_guard<mutex> lock(registryMutex);
+    liveThreads.push_back(this);
+}
+
+ThreadProfile::~ThreadProfile() {
+    {
+        lock_guard<mutex> lock(registryMutex);
+        for(int k=0;k<numProfileKernels;k++) {
+            for(int f=0;f<numFields;f++) {
+                retired[k][f] += totals[k][f].load(memory_order_relaxed);
+            }
+        }
+        liveThreads.erase(find(liveThreads.begin(), liveThreads.end(), this));
+    }
+
+    long pageSize = sysconf(_SC_PAGESIZE);
+    for(int c=0;c<numProfileCounters;c++) {
+        if(pages[c] != NULL) {
+            munmap(pages[c], pageSize);
+        }
+        if(fds[c] >= 0) {
+            close(fds[c]);
+        }
+    }
+}
+
+void ThreadProfile::read(uint64_t counts[numProfileCounters]) {
+    bool needGroupRead = false;
+    for(int c=0;c<numProfileCounters;c++) {
+        counts[c] = 0;
+        if(fds[c] >= 0 && (pages[c] == NULL || !readMapped(pages[c], counts[c]))) {
+            needGroupRead = true;
+        }
+    }
+    if(!needGroupRead) {
+        return;
+    }
+
+    // One syscall for the whole group: the number of counters, then their values
+    uint64_t values[1 + numProfileCounters];
+    if(::read(leaderFd, values, sizeof(values)) > 0) {
+        for(size_t i=0;i<order.size() && i<values[0];i++) {
+            counts[order[i]] = values[1 + i];
+        }
+    }
+}
+
+void ThreadProfile::add(int kernel, const profileSample &used) {
+    uint64_t values[numFields] = {1, used.nanoseconds, used.allocations, used.allocatedBytes};
+    for(int c=0;c<numProfileCounters;c++) {
+        values[4 + c] = used.counts[c];
+    }
+
+    atomic<uint64_t> *fields = totals[kernel];
+    for(int f=0;f<numFields;f++) {
+        fields[f].store(fields[f].load(memory_order_relaxed) + values[f], memory_order_relaxed);
+    }
+}
+
+static ThreadProfile &localProfile() {
+    thread_local ThreadProfile profile;
+    return profile;
+}
+
+
+bool enableProfiling(string &error) {
+    error = "";
+    for(int c=0;c<numProfileCounters;c++) {
+        int fd = openCounter(c, -1);
+        available[c] = fd >= 0;
+        if(fd >= 0) {
+            close(fd);
+        } else {
+            error += string(error.empty() ? "Hardware counters unavailable, timing only for:" : "") + " " + counterNames[c] + " (" + strerror(errno) + ")";
+        }
+    }
+
+    profilingEnabled.store(true);
+    return error.empty();
+}
+
+bool counterAvailable(int counter) {
+    return available[counter];
+}
+
+const char *kernelName(int kernel) {
+    return kernelNames[kernel];
+}
+
+
+void beginKernel(profileSample &start) {
+    localProfile().read(start.counts);
+    threadAllocations(start.allocations, start.allocatedBytes);
+    start.nanoseconds = monotonicNanoseconds();
+}
+
+void endKernel(int kernel, const profileSample &start) {
+    profileSample used;
+    used.nanoseconds = monotonicNanoseconds() - start.nanoseconds;
+    threadAllocations(used.allocations, used.allocatedBytes);
+    used.allocations -= start.allocations;
+    used.allocatedBytes -= start.allocatedBytes;
+
+    ThreadProfile &profile = localProfile();
+    profile.read(used.counts);
+    for(int c=0;c<numProfileCounters;c++) {
+        used.counts[c] -= start.counts[c];
+    }
+    profile.add(kernel, used);
+}
+
+
+void takeProfileSnapshot(profileSnapshot &snapshot) {
+    lock_guard<mutex> lock(registryMutex);
+    for(int k=0;k<numProfileKernels;k++) {
+        uint64_t fields[numFields];
+        for(int f=0;f<numFields;f++) {
+            fields[f] = retired[k][f];
+            for(size_t t=0;t<liveThreads.size();t++) {
+                fields[f] += liveThreads[t]->totals[k][f].load(memory_order_relaxed);
+            }
+        }
+
+        kernelCounters &counters = snapshot.kernels[k];
+        counters.calls = fields[0];
+        counters.nanoseconds = fields[1];
+        counters.allocations = fields[2];
+        counters.allocatedBytes = fields[3];
+        for(int c=0;c<numProfileCounters;c++) {
+            counters.counts[c] = fields[4 + c];
+        }
+    }
+}
+
+string formatProfile(const profileSnapshot &now, const profileSnapshot &before) {
+    string text;
+    char line[256];
+    snprintf(line, sizeof(line), "%-11s %10s %10s %14s %14s %5s %12s %12s",
+             "kernel", "calls", "ms", "cycles", "instructions", "IPC", "cache-miss", "branch-miss");
+    text += line;
+    if(allocationTracking()) {
+        snprintf(line, sizeof(line), " %10s %10s", "allocs", "alloc-KB");
+        text += line;
+    }
+
+    for(int k=0;k<numProfileKernels;k++) {
+        const kernelCounters &a = now.kernels[k];
+        const kernelCounters &b = before.kernels[k];
+        uint64_t calls = a.calls - b.calls;
+        if(calls == 0) {
+            continue;
+        }
+
+        uint64_t counts[numProfileCounters];
+        string columns[numProfileCounters];
+        for(int c=0;c<numProfileCounters;c++) {
+            counts[c] = a.counts[c] - b.counts[c];
+            columns[c] = available[c] ? to_string(counts[c]) : "n/a";
+        }
+        string ipc = "n/a";
+        if(available[counterCycles] && available[counterInstructions] && counts[counterCycles] > 0) {
+            snprintf(line, sizeof(line), "%.2f", (double)counts[counterInstructions] / counts[counterCycles]);
+            ipc = line;
+        }
+
+        snprintf(line, sizeof(line), "\n%-11s %10llu %10.2f %14s %14s %5s %12s %12s", kernelNames[k],
+                 (unsigned long long)calls, (a.nanoseconds - b.nanoseconds) / 1e6,
+                 columns[counterCycles].c_str(), columns[counterInstructions].c_str(), ipc.c_str(),
+                 columns[counterCacheMisses].c_str(), columns[counterBranchMisses].c_str());
+        text += line;
+        if(allocationTracking()) {
+            snprintf(line, sizeof(line), " %10llu %10.1f", (unsigned long long)(a.allocations - b.allocations),
+                     (a.allocatedBytes - b.allocatedBytes) / 1024.0);
+            text += line;
+        }
+    }
+    return text;
+}
@@ -0,0 +1,103 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+// Hardware counter profiling of the hot kernels (Linux perf_event_open).
+//
+// Each thread opens its own counter group (cycles, instructions, cache misses,
+// branch misses, user space only) the first time it runs a probed kernel, and
+// reads it on entry and exit of the kernel, with rdpmc where the kernel allows
+// it and read() otherwise. Counts are inclusive: a crossover includes the
+// collision checks it makes. Wall time is recorded even when the counters
+// cannot be opened (no PMU in a VM, perf_event_paranoid too high), and in
+// builds with allocation tracking (see memorybudget.h) so are allocations.
+//
+// When profiling is off a probe costs one relaxed load.
+
+enum profileKernel {
+    kernelFitness,
+    kernelCollision,
+    kernelRandomFold,
+    kernelCrossover,
+    kernelMutate,
+    kernelGrabParent,
+    kernelSort,
+    kernelDedup,
+    numProfileKernels
+};
+
+enum profileCounter {
+    counterCycles,
+    counterInstructions,
+    counterCacheMisses,
+    counterBranchMisses,
+    numProfileCounters
+};
+
+struct kernelCounters {
+    uint64_t calls;
+    uint64_t nanoseconds;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+    uint64_t counts[numProfileCounters];
+};
+
+struct profileSnapshot {
+    kernelCounters kernels[numProfileKernels];
+};
+
+extern std::atomic<bool> profilingEnabled;
+
+// Turns profiling on. Returns false with the reason if some hardware counters
+// cannot be opened, profiling still runs with what is left.
+bool enableProfiling(std::string &error);
+bool counterAvailable(int counter);
+
+const char *kernelName(int kernel);
+
+// Totals over all threads since profiling was enabled
+void takeProfileSnapshot(profileSnapshot &snapshot);
+
+// Table of the kernels that ran between two snapshots, one line each
+std::string formatProfile(const profileSnapshot &now, const profileSnapshot &before);
+
+
+// Counter values at the start of a probe
+struct profileSample {
+    uint64_t nanoseconds;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+    uint64_t counts[numProfileCounters];
+};
+
+void beginKernel(profileSample &start);
+void endKernel(int kernel, const profileSample &start);
+
+// Counts the scope it lives in against kernel
+class KernelProbe
+{
+public:
+    explicit KernelProbe(profileKernel kernel) :
+        kernel(kernel),
+        active(profilingEnabled.load(std::memory_order_relaxed))
+    {
+        if(active) {
+            beginKernel(start);
+        }
+    }
+    ~KernelProbe() {
+        if(active) {
+            endKernel(kernel, start);
+        }
+    }
+
+private:
+    profileKernel kernel;
+    bool active;
+    profileSample start;
+};
+
+#endif // PERFCOUNTERS_H
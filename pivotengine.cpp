@@ -0,0 +1,90 @@
+#include "pivotengine.h"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+
+PivotEngine::PivotEngine(const string &proteinSequence, int targetFitness, const foldingOptions &options) :
+    FoldingEngine(targetFitness),
+    proteinSequence(proteinSequence),
+    hIndex(buildContactIndex(proteinSequence, getEnergyModel(options))),
+    options(options),
+    currentFitness(0),
+    temperature(options.pivotStartTemperature),
+    acceptance(0),
+    stepNum(0)
+{
+    // A straight rod heading east is always self-avoiding and has no contacts
+    string rod(proteinSequence.size() - 1, '2');
+    rod.push_back('0');
+    tree.build(hIndex, rod);
+
+    bestNode.proteinDirection = rod;
+    bestNode.fitness = 0;
+}
+
+
+bool PivotEngine::step() {
+    stepNum++;
+
+    double fraction = min(1.0, (double)(stepNum - 1) / max(1, options.pivotCoolingSteps));
+    temperature = options.pivotStartTemperature * pow(options.pivotEndTemperature / options.pivotStartTemperature, fraction);
+
+    int numSites = tree.size();
+    int numAccepted = 0;
+    int bestThisStep = bestNode.fitness;
+    for(int i=0;i<options.pivotMovesPerStep && numSites > 2;i++) {
+        // Pivoting at the first or last site would just turn the whole chain
+        int site = 1 + foldRand() % (numSites - 2);
+        int symmetry = 1 + foldRand() % (SawTree::numSymmetries - 1);
+
+        int fitnessChange;
+        if(!tree.testPivot(site, symmetry, fitnessChange)) {
+            continue;
+        }
+
+        // Metropolis rule, in the model's energy units
+        if(fitnessChange > 0 && foldRand() / 2147483648.0 >= exp(-fitnessChange / temperature)) {
+            continue;
+        }
+
+        tree.applyPivot(site, symmetry);
+        currentFitness += fitnessChange;
+        numAccepted++;
+
+        if(currentFitness < bestThisStep) {
+            bestThisStep = currentFitness;
+            if(currentFitness <= targetFitness) {
+                break;
+            }
+        }
+    }
+    acceptance = options.pivotMovesPerStep > 0 ? (double)numAccepted / options.pivotMovesPerStep : 0;
+
+    // Only keep the chain at the end of a step (or once it hits the target), writing out the directions is O(n)
+    if(currentFitness < bestNode.fitness) {
+        bestNode.fitness = currentFitness;
+        bestNode.proteinDirection = tree.getDirections();
+    }
+
+    return isSolved();
+}
+
+
+void PivotEngine::seedFolds(const vector<string> &folds) {
+    for(size_t i=0;i<folds.size();i++) {
+        int fitness = getFitnessRating(hIndex, folds[i]);
+        if(fitness >= currentFitness) {
+            continue;
+        }
+
+        tree.build(hIndex, folds[i]);
+        currentFitness = fitness;
+        if(fitness < bestNode.fitness) {
+            bestNode.proteinDirection = folds[i];
+            bestNode.fitness = fitness;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef PIVOTENGINE_H
+#define PIVOTENGINE_H
+
+#include <string>
+
+#include "foldingengine.h"
+#include "sawtree.h"
+
+// Long-chain mode: simulated annealing of a single chain with pivot moves
+// (turn everything after a random site about it, the way mutate() does),
+// kept on a SAW-tree so a move is checked and scored without walking the
+// whole chain. Starts from a straight rod, so neither the grid size
+// (maxFitnessLimit) nor rejection sampling of random walks limits the
+// length; meant for chains of thousands of residues and up.
+//
+// A step() is pivotMovesPerStep attempted pivots. The temperature falls
+// geometrically from pivotStartTemperature to pivotEndTemperature over
+// pivotCoolingSteps steps and then stays there.
+class PivotEngine : public FoldingEngine
+{
+public:
+    PivotEngine(const std::string &proteinSequence, int targetFitness, const foldingOptions &options);
+
+    bool step();
+    // Restarts the chain from the best seed if it beats the current one
+    void seedFolds(const std::vector<std::string> &folds);
+
+    const proteinNode &best() const { return bestNode; }
+    int generation() const { return stepNum; }
+
+    int getCurrentFitness() const { return currentFitness; }
+    double getTemperature() const { return temperature; }
+    // Fraction of the last step's pivots that were self-avoiding and accepted
+    double getAcceptance() const { return acceptance; }
+
+private:
+    std::string proteinSequence;
+    contactIndex hIndex;
+    foldingOptions options;
+
+    SawTree tree;
+    int currentFitness;
+    double temperature;
+    double acceptance;
+
+    proteinNode bestNode;
+    int stepNum;
+};
+
+#endif // PIVOTENGINE_H
@@ -0,0 +1,282 @@
+#include "proteinrenderer.h"
+
+#include <QImage>
+#include <QDir>
+#include <QFont>
+
+#include <unordered_map>
+#include <cstdio>
+#include <cstdint>
+
+using namespace std;
+
+
+// Frames larger than this are drawn with a smaller spacing
+static const int maxFrameSize = 2048;
+static const int frameMargin = 40;
+
+
+proteinLayout layoutProtein(const string &proteinSequence, const string &proteinDirection) {
+    proteinLayout layout;
+    int length = proteinDirection.size();
+
+    layout.x.resize(length);
+    layout.y.resize(length);
+    layout.minX = layout.maxX = layout.minY = layout.maxY = 0;
+
+    unordered_map<uint64_t, int> occupied;
+    occupied.reserve(length * 2);
+
+    int currX = 0;
+    int currY = 0;
+    for(int i=0;i<length;i++) {
+        layout.x[i] = currX;
+        layout.y[i] = currY;
+        occupied[((uint64_t)(uint32_t)currX << 32) | (uint32_t)currY] = i;
+
+        layout.minX = min(layout.minX, currX);
+        layout.maxX = max(layout.maxX, currX);
+        layout.minY = min(layout.minY, currY);
+        layout.maxY = max(layout.maxY, currY);
+
+        char currentDirection = proteinDirection[i];
+        if(currentDirection == '1') {
+            currY--;
+        }
+        else if(currentDirection == '2') {
+            currX++;
+        }
+        else if(currentDirection == '3') {
+            currY++;
+        }
+        else if(currentDirection == '4') {
+            currX--;
+        }
+    }
+
+    // Look up the neighbours of each H, keeping pairs that are not bonded
+    static const int offsetX[4] = { 0, 1, 0, -1 };
+    static const int offsetY[4] = { -1, 0, 1, 0 };
+    for(int i=0;i<length;i++) {
+        if(proteinSequence[i] != 'h') {
+            continue;
+        }
+        for(int d=0;d<4;d++) {
+            int nx = layout.x[i] + offsetX[d];
+            int ny = layout.y[i] + offsetY[d];
+            auto found = occupied.find(((uint64_t)(uint32_t)nx << 32) | (uint32_t)ny);
+            if(found != occupied.end() && found->second > i+1 && proteinSequence[found->second] == 'h') {
+                layout.contacts.push_back(make_pair(i, found->second));
+            }
+        }
+    }
+
+    return layout;
+}
+
+
+// proteinSequence = h=Hydrophobic(special/red) p=Hydrophilic(black)
+void paintProtein(QPainter &p, const string &proteinSequence, const proteinLayout &layout, int pixelSpacing, int originX, int originY) {
+    int length = layout.x.size();
+
+    p.setRenderHint(QPainter::Antialiasing);
+
+    // First draw the lines between each residue
+    p.setPen(QPen(Qt::black, 3, Qt::SolidLine, Qt::FlatCap, Qt::BevelJoin));
+    for(int i=0;i<length-1;i++) {
+        p.drawLine(originX + layout.x[i] * pixelSpacing, originY + layout.y[i] * pixelSpacing,
+                   originX + layout.x[i+1] * pixelSpacing, originY + layout.y[i+1] * pixelSpacing);
+    }
+
+    // Next draw dotted lines for fitness connections
+    p.setPen(QPen(Qt::black, 1, Qt::DotLine, Qt::FlatCap, Qt::BevelJoin));
+    for(size_t c=0;c<layout.contacts.size();c++) {
+        int i = layout.contacts[c].first;
+        int j = layout.contacts[c].second;
+        p.drawLine(originX + layout.x[i] * pixelSpacing, originY + layout.y[i] * pixelSpacing,
+                   originX + layout.x[j] * pixelSpacing, originY + layout.y[j] * pixelSpacing);
+    }
+
+    // Finally draw the dot for the type of amino acid on top of the lines
+    int dotSize = min(12, max(2, pixelSpacing / 2));
+    for(int i=0;i<length;i++) {
+        if(proteinSequence[i] == 'h') {
+            p.setPen(QPen(Qt::red, dotSize, Qt::SolidLine, Qt::RoundCap));
+        } else {
+            p.setPen(QPen(Qt::black, dotSize, Qt::SolidLine, Qt::RoundCap));
+        }
+        p.drawPoint(originX + layout.x[i] * pixelSpacing, originY + layout.y[i] * pixelSpacing);
+    }
+}
+
+
+// Draws and returns a QPicture based on the input sequence and direction inputs
+QPicture drawProtein(string proteinSequence, string proteinDirection, int maxFitnessLimit, int pixelSpacing) {
+    QPicture pi;
+    QPainter p(&pi);
+
+    proteinLayout layout = layoutProtein(proteinSequence, proteinDirection);
+    paintProtein(p, proteinSequence, layout, pixelSpacing, maxFitnessLimit * pixelSpacing, maxFitnessLimit * pixelSpacing);
+
+    p.end();
+
+    return pi;
+}
+
+
+
+AsyncRenderer::AsyncRenderer() :
+    running(false),
+    quit(false),
+    hasPending(false),
+    minInterval(0),
+    pixelSpacing(25),
+    frameNum(0)
+{
+}
+
+AsyncRenderer::~AsyncRenderer()
+{
+    stop();
+}
+
+
+bool AsyncRenderer::start(const string &frameDirectory, int pixelSpacing, int maxFrameRate, string &error) {
+    stop();
+
+    if(!QDir().mkpath(QString::fromStdString(frameDirectory))) {
+        error = "Error creating frame directory: " + frameDirectory;
+        return false;
+    }
+
+    this->frameDirectory = frameDirectory;
+    this->pixelSpacing = pixelSpacing;
+    frameNum = 0;
+
+    if(maxFrameRate > 0) {
+        minInterval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::seconds(1)) / maxFrameRate;
+    } else {
+        minInterval = chrono::steady_clock::duration(0);
+    }
+    lastSubmit = chrono::steady_clock::now() - minInterval;
+    lastDirection.clear();
+    lastSequence.clear();
+
+    quit = false;
+    hasPending = false;
+    running = true;
+    worker = thread(&AsyncRenderer::renderLoop, this);
+    return true;
+}
+
+
+// Renders whatever is still pending, then joins the render thread
+void AsyncRenderer::stop() {
+    if(!running) {
+        return;
+    }
+
+    {
+        lock_guard<mutex> guard(lock);
+        quit = true;
+    }
+    wake.notify_one();
+    worker.join();
+    running = false;
+}
+
+
+bool AsyncRenderer::submit(const string &proteinSequence, const string &proteinDirection, int fitness, int generation) {
+    if(!running) {
+        return false;
+    }
+
+    // Only snapshot when the conformation changed, and at most at the frame rate
+    if(proteinDirection == lastDirection && proteinSequence == lastSequence) {
+        return false;
+    }
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if(now - lastSubmit < minInterval) {
+        return false;
+    }
+
+    // Never wait on the render thread, try again next generation instead
+    unique_lock<mutex> guard(lock, try_to_lock);
+    if(!guard.owns_lock()) {
+        return false;
+    }
+
+    pending.proteinSequence = proteinSequence;
+    pending.proteinDirection = proteinDirection;
+    pending.fitness = fitness;
+    pending.generation = generation;
+    hasPending = true;
+    guard.unlock();
+    wake.notify_one();
+
+    lastDirection = proteinDirection;
+    lastSequence = proteinSequence;
+    lastSubmit = now;
+    return true;
+}
+
+
+int AsyncRenderer::framesWritten() {
+    return frameNum;
+}
+
+
+void AsyncRenderer::renderLoop() {
+    snapshot frame;
+
+    while(true) {
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [this] { return hasPending || quit; });
+
+            if(!hasPending) {
+                return;
+            }
+
+            // Swap so both sides keep their string capacity
+            swap(frame, pending);
+            hasPending = false;
+        }
+
+        renderFrame(frame);
+    }
+}
+
+
+void AsyncRenderer::renderFrame(const snapshot &frame) {
+    proteinLayout layout = layoutProtein(frame.proteinSequence, frame.proteinDirection);
+
+    // Fit the frame around the chain, shrinking the spacing for long chains
+    int spanX = layout.maxX - layout.minX;
+    int spanY = layout.maxY - layout.minY;
+    int spacing = pixelSpacing;
+    while(spacing > 2 && max(spanX, spanY) * spacing + frameMargin * 2 > maxFrameSize) {
+        spacing--;
+    }
+
+    int width = spanX * spacing + frameMargin * 2;
+    int height = spanY * spacing + frameMargin * 2;
+
+    QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+    image.fill(QColor(Qt::white));
+
+    QPainter p(&image);
+    paintProtein(p, frame.proteinSequence, layout, spacing,
+                 frameMargin - layout.minX * spacing, frameMargin - layout.minY * spacing);
+
+    string caption = "Generation: " + to_string(frame.generation) + "   Fitness: " + to_string(frame.fitness);
+    p.setPen(QPen(Qt::black, 1));
+    p.setFont(QFont("Arial", 10));
+    p.drawText(5, 15, QString::fromStdString(caption));
+    p.end();
+
+    char frameName[32];
+    snprintf(frameName, sizeof(frameName), "/frame_%06d.png", frameNum + 1);
+    image.save(QString::fromStdString(frameDirectory + frameName), "PNG");
+    frameNum++;
+}
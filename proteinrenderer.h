@@ -0,0 +1,92 @@
+#ifndef PROTEINRENDERER_H
+#define PROTEINRENDERER_H
+
+#include <QPicture>
+#include <QPainter>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+
+// Lattice coordinates of one conformation plus its H-H contacts, sized by
+// the chain rather than by maxFitnessLimit
+struct proteinLayout {
+    std::vector<int> x;
+    std::vector<int> y;
+
+    // Pairs of chain indices (i < j) that form a contact
+    std::vector<std::pair<int, int>> contacts;
+
+    int minX, maxX, minY, maxY;
+};
+
+proteinLayout layoutProtein(const std::string &proteinSequence, const std::string &proteinDirection);
+
+// Paints the chain with (originX, originY) as the position of the first residue
+void paintProtein(QPainter &p, const std::string &proteinSequence, const proteinLayout &layout, int pixelSpacing, int originX, int originY);
+
+// Draws and returns a QPicture based on the input sequence and direction inputs
+QPicture drawProtein(std::string proteinSequence, std::string proteinDirection, int maxFitnessLimit, int pixelSpacing);
+
+
+// Writes the best conformation to numbered PNG frames on its own thread.
+//
+// The GA hands snapshots over with submit(), which never waits: if the
+// renderer is busy copying the previous snapshot the new one is simply
+// skipped and retried on the next generation. Frames are only taken when
+// the conformation changes, and no more than maxFrameRate times a second.
+// The frames are numbered frame_000001.png, ... so they can be turned into
+// a video directly (e.g. ffmpeg -i frame_%06d.png).
+class AsyncRenderer
+{
+public:
+    AsyncRenderer();
+    ~AsyncRenderer();
+
+    bool start(const std::string &frameDirectory, int pixelSpacing, int maxFrameRate, std::string &error);
+    void stop();
+
+    bool isRunning() const { return running; }
+
+    // Called from the GA thread. Returns true if the snapshot was handed over.
+    bool submit(const std::string &proteinSequence, const std::string &proteinDirection, int fitness, int generation);
+
+    int framesWritten();
+
+private:
+    struct snapshot {
+        std::string proteinSequence;
+        std::string proteinDirection;
+        int fitness;
+        int generation;
+    };
+
+    void renderLoop();
+    void renderFrame(const snapshot &frame);
+
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable wake;
+
+    bool running;
+    bool quit;
+    bool hasPending;
+    snapshot pending;
+
+    // Only touched by the GA thread
+    std::string lastDirection;
+    std::string lastSequence;
+    std::chrono::steady_clock::time_point lastSubmit;
+    std::chrono::steady_clock::duration minInterval;
+
+    // Only touched by the render thread, apart from framesWritten()
+    std::string frameDirectory;
+    int pixelSpacing;
+    std::atomic<int> frameNum;
+};
+
+#endif // PROTEINRENDERER_H
@@ -0,0 +1,140 @@
+#include "replicaexchange.h"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+
+// Share of moves that are crossovers with the replica's own best fold, the rest are mutations
+static const int crossoverMovePercentage = 30;
+
+
+ReplicaExchangeEngine::ReplicaExchangeEngine(const string &proteinSequence, int targetFitness, const foldingOptions &options) :
+    FoldingEngine(targetFitness),
+    proteinSequence(proteinSequence),
+    hIndex(buildContactIndex(proteinSequence, getEnergyModel(options))),
+    options(options),
+    numReplicas(options.reReplicas > 0 ? options.reReplicas : thread::hardware_concurrency()),
+    roundNum(0),
+    pool(min(max(2, numReplicas), engineThreadCount(options)))
+{
+    numReplicas = max(2, numReplicas);
+
+    // Temperature ladder, coldest first
+    temperatures.resize(numReplicas);
+    for(int k=0;k<numReplicas;k++) {
+        double fraction = (double)k / (numReplicas - 1);
+        if(options.reLadder == "linear") {
+            temperatures[k] = options.reMinTemperature + fraction * (options.reMaxTemperature - options.reMinTemperature);
+        } else {
+            temperatures[k] = options.reMinTemperature * pow(options.reMaxTemperature / options.reMinTemperature, fraction);
+        }
+    }
+
+    replicas.resize(numReplicas);
+    replicaAt.resize(numReplicas);
+    swapsAccepted.assign(numReplicas, 0);
+    swapsAttempted.assign(numReplicas, 0);
+
+    int currSize = proteinSequence.size();
+    for(int k=0;k<numReplicas;k++) {
+        replica &r = replicas[k];
+        r.current.proteinDirection = createRandomSequence(currSize, options.maxFitnessLimit);
+        r.current.fitness = getFitnessRating(hIndex, r.current.proteinDirection);
+        r.bestSeen = r.current;
+        r.temperature = temperatures[k];
+        r.accepted = 0;
+        r.attempted = 0;
+        replicaAt[k] = k;
+
+        if(k == 0 || r.current.fitness < bestNode.fitness) {
+            bestNode = r.current;
+        }
+    }
+}
+
+
+double ReplicaExchangeEngine::getSwapRate(int k) const {
+    if(swapsAttempted[k] == 0) {
+        return 0;
+    }
+    return (double)swapsAccepted[k] / swapsAttempted[k];
+}
+
+
+// Metropolis moves at the replica's current temperature
+void ReplicaExchangeEngine::sweep(replica &r) {
+    for(int m=0;m<options.reMovesPerSwap;m++) {
+        proteinNode candidate;
+        if(foldRand() % 100 < crossoverMovePercentage && r.bestSeen.proteinDirection != r.current.proteinDirection) {
+            candidate = crossover(r.current, r.bestSeen, options.numToTry, options.maxFitnessLimit, hIndex);
+        } else {
+            candidate.proteinDirection = mutate(r.current.proteinDirection, options.numToTry, options.maxFitnessLimit);
+        }
+        r.attempted++;
+        if(candidate.proteinDirection == "failed") {
+            continue;
+        }
+        candidate.fitness = getFitnessRating(hIndex, candidate.proteinDirection);
+
+        int delta = candidate.fitness - r.current.fitness;
+        if(delta <= 0 || foldRand() / 2147483648.0 < exp(-delta / r.temperature)) {
+            r.current.proteinDirection.swap(candidate.proteinDirection);
+            r.current.fitness = candidate.fitness;
+            r.accepted++;
+
+            if(r.current.fitness < r.bestSeen.fitness) {
+                r.bestSeen = r.current;
+            }
+        }
+    }
+}
+
+
+bool ReplicaExchangeEngine::step() {
+    // One sweep of every replica, spread over the pool
+    pool.run(numReplicas, [this](int k, int) { sweep(replicas[k]); });
+
+    roundNum++;
+
+    // Neighbour swaps, alternating even and odd pairs
+    for(int k=roundNum%2;k+1<numReplicas;k+=2) {
+        int a = replicaAt[k];
+        int b = replicaAt[k+1];
+        double delta = (1.0/temperatures[k] - 1.0/temperatures[k+1]) * (replicas[a].current.fitness - replicas[b].current.fitness);
+
+        swapsAttempted[k]++;
+        if(delta >= 0 || foldRand() / 2147483648.0 < exp(delta)) {
+            replicaAt[k] = b;
+            replicaAt[k+1] = a;
+            replicas[b].temperature = temperatures[k];
+            replicas[a].temperature = temperatures[k+1];
+            swapsAccepted[k]++;
+        }
+    }
+
+    for(int k=0;k<numReplicas;k++) {
+        if(replicas[k].bestSeen.fitness < bestNode.fitness) {
+            bestNode = replicas[k].bestSeen;
+        }
+    }
+
+    return bestNode.fitness <= targetFitness;
+}
+
+
+// Only called between rounds, while the pool is idle
+void ReplicaExchangeEngine::seedFolds(const vector<string> &folds) {
+    for(size_t k=0;k<folds.size() && (int)k<numReplicas;k++) {
+        replica &r = replicas[replicaAt[k]];
+        r.current.proteinDirection = folds[k];
+        r.current.fitness = getFitnessRating(hIndex, folds[k]);
+        if(r.current.fitness < r.bestSeen.fitness) {
+            r.bestSeen = r.current;
+        }
+        if(r.current.fitness < bestNode.fitness) {
+            bestNode = r.current;
+        }
+    }
+}
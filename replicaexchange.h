@@ -0,0 +1,71 @@
+#ifndef REPLICAEXCHANGE_H
+#define REPLICAEXCHANGE_H
+
+#include <string>
+#include <vector>
+
+#include "foldingengine.h"
+#include "workerpool.h"
+
+// Parallel tempering: one Metropolis chain per temperature, swept in parallel
+// on the engine's worker pool, using the mutate/crossover operators as moves.
+//
+// A step() is one round: every replica makes reMovesPerSwap moves at its
+// temperature, then neighbouring temperatures try to swap replicas (even
+// pairs one round, odd pairs the next). The swaps just exchange entries of
+// the temperature -> replica table, so conformations are never copied
+// between threads. Hot replicas wander out of traps and pass good regions
+// down to the cold end, which is a much better escape than the apocalypse
+// restart.
+class ReplicaExchangeEngine : public FoldingEngine
+{
+public:
+    ReplicaExchangeEngine(const std::string &proteinSequence, int targetFitness, const foldingOptions &options);
+
+    bool step();
+    // Seeds go to the coldest replicas first
+    void seedFolds(const std::vector<std::string> &folds);
+
+    const proteinNode &best() const { return bestNode; }
+    int generation() const { return roundNum; }
+
+    int getNumReplicas() const { return numReplicas; }
+    const std::vector<double> &getTemperatures() const { return temperatures; }
+    // Fraction of accepted swaps between temperature k and k+1
+    double getSwapRate(int k) const;
+
+private:
+    struct replica {
+        proteinNode current;
+        proteinNode bestSeen;
+        double temperature;
+        long accepted;
+        long attempted;
+
+        // Keeps replicas on different threads off each other's cache lines
+        char padding[64];
+    };
+
+    void sweep(replica &r);
+
+    std::string proteinSequence;
+    contactIndex hIndex;
+    foldingOptions options;
+
+    int numReplicas;
+    std::vector<double> temperatures;
+    // Which replica currently sits at each temperature
+    std::vector<int> replicaAt;
+    std::vector<replica> replicas;
+
+    std::vector<long> swapsAccepted;
+    std::vector<long> swapsAttempted;
+
+    proteinNode bestNode;
+    int roundNum;
+
+    // Last, so it is gone before anything its threads touch
+    WorkerPool pool;
+};
+
+#endif // REPLICAEXCHANGE_H
@@ -0,0 +1,123 @@
+#include "restartscheduler.h"
+#include "foldingengine.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+long lubyTerm(long i) {
+    // Find the block 2^k - 1 that i falls in: its last term is 2^(k-1), the rest repeats the sequence
+    while(true) {
+        int k = 1;
+        while((1L << k) - 1 < i) {
+            k++;
+        }
+        if(i == (1L << k) - 1) {
+            return 1L << (k - 1);
+        }
+        i -= (1L << (k - 1)) - 1;
+    }
+}
+
+
+RestartScheduler::RestartScheduler() :
+    policy("luby"),
+    growth(1.5),
+    subPopulations(1),
+    generations(50),
+    stopping(false),
+    restartNum(0)
+{
+}
+
+RestartScheduler::~RestartScheduler()
+{
+    cancel();
+}
+
+
+void RestartScheduler::configure(const string &policy, double growth, int subPopulations, int generations) {
+    this->policy = policy;
+    this->growth = max(growth, 1.0);
+    this->subPopulations = max(subPopulations, 1);
+    this->generations = max(generations, 1);
+}
+
+
+long RestartScheduler::interval(int trigger) const {
+    double factor = 1;
+    if(policy == "luby") {
+        factor = lubyTerm(restartNum + 1);
+    } else if(policy == "geometric") {
+        factor = pow(growth, restartNum);
+    }
+    // Long runs must not overflow into a restart that never comes
+    return (long)min(max(trigger, 1) * factor, 1e15);
+}
+
+
+bool RestartScheduler::ready() const {
+    if(jobs.empty()) {
+        return false;
+    }
+    for(size_t j=0;j<jobs.size();j++) {
+        if(!jobs[j]->done.load(memory_order_acquire)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void RestartScheduler::launch(const string &proteinSequence, int targetFitness, const foldingOptions &options) {
+    // The fresh populations never restart themselves, and already have a thread each
+    foldingOptions freshOptions = options;
+    freshOptions.apocalypse = 0;
+    freshOptions.engineThreads = 1;
+
+    stopping = false;
+    for(int s=0;s<subPopulations;s++) {
+        jobs.push_back(unique_ptr<restartJob>(new restartJob()));
+        restartJob *job = jobs.back().get();
+        job->done = false;
+        // Seeded from this thread like WorkerPool's helpers
+        unsigned int seed = foldRand();
+        // Built on the worker too, so the foreground does not pay for the random folds either
+        job->worker = thread([this, job, seed, proteinSequence, targetFitness, freshOptions]() {
+            seedFoldRand(seed);
+            job->engine.reset(new GeneticEngine(proteinSequence, targetFitness, freshOptions));
+            for(int g=0;g<generations && !stopping.load(memory_order_relaxed);g++) {
+                if(job->engine->step()) {
+                    break;
+                }
+            }
+            job->done.store(true, memory_order_release);
+        });
+    }
+}
+
+
+vector<proteinNode> RestartScheduler::collect() {
+    vector<proteinNode> folds;
+    for(size_t j=0;j<jobs.size();j++) {
+        jobs[j]->worker.join();
+        const vector<proteinNode> &population = jobs[j]->engine->getPopulation();
+        folds.insert(folds.end(), population.begin(), population.end());
+    }
+    jobs.clear();
+    restartNum++;
+
+    stable_sort(folds.begin(), folds.end(), ascending());
+    return folds;
+}
+
+
+void RestartScheduler::cancel() {
+    stopping = true;
+    for(size_t j=0;j<jobs.size();j++) {
+        jobs[j]->worker.join();
+    }
+    jobs.clear();
+}
@@ -0,0 +1,70 @@
+#ifndef RESTARTSCHEDULER_H
+#define RESTARTSCHEDULER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+#include "folding.h"
+
+struct foldingOptions;
+class GeneticEngine;
+
+// Restarts for the GA (the apocalypse), run next to the search instead of in
+// place of it.
+//
+// A restart is due once the best fitness has not improved for an interval
+// that follows a policy, in units of the apocalypse trigger:
+//   fixed      1, 1, 1, ...
+//   luby       1, 1, 2, 1, 1, 2, 4, 1, 1, 2, ... (Luby et al.)
+//   geometric  1, g, g^2, ...
+// When it is, launch() starts apocSubPopulations fresh populations, each a GA
+// of its own built and evolved for apocGenerations generations on its own
+// thread, while the stagnating population keeps going. Once they are all
+// done collect() hands over their folds for the engine to merge with its own
+// survivors, and the next interval starts.
+class RestartScheduler
+{
+public:
+    RestartScheduler();
+    ~RestartScheduler();
+
+    void configure(const std::string &policy, double growth, int subPopulations, int generations);
+
+    // Generations without improvement before restart number numRestarts() is due
+    long interval(int trigger) const;
+    int numRestarts() const { return restartNum; }
+
+    bool running() const { return !jobs.empty(); }
+    // True once every fresh population of the running restart is done
+    bool ready() const;
+
+    void launch(const std::string &proteinSequence, int targetFitness, const foldingOptions &options);
+    // Joins the finished restart and returns all its folds, fittest first
+    std::vector<proteinNode> collect();
+
+private:
+    struct restartJob {
+        std::unique_ptr<GeneticEngine> engine;
+        std::thread worker;
+        std::atomic<bool> done;
+    };
+
+    void cancel();
+
+    std::string policy;
+    double growth;
+    int subPopulations;
+    int generations;
+
+    std::vector<std::unique_ptr<restartJob>> jobs;
+    std::atomic<bool> stopping;
+    int restartNum;
+};
+
+// Term i (from 1) of the Luby sequence 1, 1, 2, 1, 1, 2, 4, 1, ...
+long lubyTerm(long i);
+
+#endif // RESTARTSCHEDULER_H
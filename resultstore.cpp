@@ -0,0 +1,401 @@
+#include "resultstore.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+static const char storeMagic[8] = {'P', 'F', 'S', 'T', 'O', 'R', 'E', '1'};
+static const size_t initialStoreSize = 1 << 20;
+// Tries at growing the rest of a chain around a stored piece
+static const int growAttempts = 20;
+
+struct storeHeader {
+    char magic[8];
+    // Offset just past the last record
+    uint64_t dataEnd;
+    uint64_t numRecords;
+    uint64_t reserved;
+};
+
+// Followed by the sequence and then its directional sequence, length bytes each, padded to 8
+struct storeRecord {
+    uint64_t key;
+    uint64_t modelKey;
+    int64_t updated;
+    int32_t fitness;
+    int32_t length;
+};
+
+
+// FNV-1a
+static uint64_t hashBytes(const string &bytes, uint64_t hash = 0xcbf29ce484222325ULL) {
+    for(size_t i=0;i<bytes.size();i++) {
+        hash ^= (unsigned char)bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t sequenceKey(const string &energyModel, const string &proteinSequence) {
+    return hashBytes(proteinSequence, hashBytes(energyModel + '\0'));
+}
+
+static inline storeRecord *recordAt(char *map, uint64_t offset) {
+    return (storeRecord *)(map + offset);
+}
+
+static size_t recordSize(size_t length) {
+    return (sizeof(storeRecord) + 2 * length + 7) / 8 * 8;
+}
+
+
+ResultStore::ResultStore() :
+    fd(-1),
+    map(NULL),
+    mapSize(0)
+{
+}
+
+ResultStore::~ResultStore() {
+    close();
+}
+
+
+bool ResultStore::open(const string &filename, string &error) {
+    close();
+    this->filename = filename;
+
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0) {
+        error = "Error opening file: " + filename + "\n" + "ERROR: " + strerror(errno);
+        return false;
+    }
+    if(flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        error = "Error opening file: " + filename + "\n" + "ERROR: store is in use by another run";
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    struct stat fileStat;
+    fstat(fd, &fileStat);
+    bool created = fileStat.st_size == 0;
+    mapSize = created ? initialStoreSize : fileStat.st_size;
+    if(created && ftruncate(fd, mapSize) < 0) {
+        error = "Error growing file: " + filename + "\n" + "ERROR: " + strerror(errno);
+        close();
+        return false;
+    }
+
+    void *mapped = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(mapped == MAP_FAILED) {
+        error = "Error mapping file: " + filename + "\n" + "ERROR: " + strerror(errno);
+        map = NULL;
+        close();
+        return false;
+    }
+    map = (char *)mapped;
+
+    storeHeader *header = (storeHeader *)map;
+    if(created) {
+        memcpy(header->magic, storeMagic, sizeof(storeMagic));
+        header->dataEnd = sizeof(storeHeader);
+        header->numRecords = 0;
+        header->reserved = 0;
+    } else if(mapSize < sizeof(storeHeader) || memcmp(header->magic, storeMagic, sizeof(storeMagic)) != 0 ||
+              header->dataEnd > mapSize) {
+        error = "Error opening file: " + filename + "\n" + "ERROR: not a results store";
+        close();
+        return false;
+    }
+
+    // Rebuild the index, stopping at the first record that does not fit (a run that died mid-append)
+    uint64_t offset = sizeof(storeHeader);
+    while(offset + sizeof(storeRecord) <= header->dataEnd) {
+        storeRecord *stored = recordAt(map, offset);
+        if(stored->length <= 0 || offset + recordSize(stored->length) > header->dataEnd) {
+            break;
+        }
+        index[stored->key] = offset;
+        offset += recordSize(stored->length);
+    }
+    header->dataEnd = offset;
+    header->numRecords = index.size();
+
+    return true;
+}
+
+void ResultStore::close() {
+    if(map != NULL) {
+        msync(map, mapSize, MS_SYNC);
+        munmap(map, mapSize);
+        map = NULL;
+    }
+    if(fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    mapSize = 0;
+    index.clear();
+}
+
+
+// Makes room for needed more bytes by doubling the file and mapping it again
+bool ResultStore::grow(size_t needed, string &error) {
+    storeHeader *header = (storeHeader *)map;
+    if(header->dataEnd + needed <= mapSize) {
+        return true;
+    }
+
+    size_t newSize = mapSize;
+    while(header->dataEnd + needed > newSize) {
+        newSize *= 2;
+    }
+    if(ftruncate(fd, newSize) < 0) {
+        error = "Error growing file: " + filename + "\n" + "ERROR: " + strerror(errno);
+        return false;
+    }
+
+    munmap(map, mapSize);
+    void *mapped = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(mapped == MAP_FAILED) {
+        error = "Error mapping file: " + filename + "\n" + "ERROR: " + strerror(errno);
+        map = NULL;
+        close();
+        return false;
+    }
+    map = (char *)mapped;
+    mapSize = newSize;
+    return true;
+}
+
+
+bool ResultStore::lookup(const string &energyModel, const string &proteinSequence, proteinNode &best) const {
+    if(map == NULL) {
+        return false;
+    }
+
+    unordered_map<uint64_t, uint64_t>::const_iterator found = index.find(sequenceKey(energyModel, proteinSequence));
+    if(found == index.end()) {
+        return false;
+    }
+
+    storeRecord *stored = recordAt(map, found->second);
+    const char *storedSequence = (const char *)(stored + 1);
+    if(stored->length != (int)proteinSequence.size() || memcmp(storedSequence, proteinSequence.data(), stored->length) != 0) {
+        return false;
+    }
+
+    best.fitness = stored->fitness;
+    best.proteinDirection.assign(storedSequence + stored->length, stored->length);
+    return true;
+}
+
+
+bool ResultStore::record(const string &energyModel, const string &proteinSequence, const proteinNode &fold) {
+    if(map == NULL || fold.proteinDirection.size() != proteinSequence.size()) {
+        return false;
+    }
+
+    uint64_t key = sequenceKey(energyModel, proteinSequence);
+    unordered_map<uint64_t, uint64_t>::const_iterator found = index.find(key);
+    if(found != index.end()) {
+        storeRecord *stored = recordAt(map, found->second);
+        // A different sequence under the same key keeps its record, like lookup() does
+        const char *storedSequence = (const char *)(stored + 1);
+        if(stored->length != (int)proteinSequence.size() || memcmp(storedSequence, proteinSequence.data(), stored->length) != 0) {
+            return false;
+        }
+        if(stored->fitness <= fold.fitness) {
+            return false;
+        }
+        memcpy((char *)(stored + 1) + stored->length, fold.proteinDirection.data(), stored->length);
+        stored->fitness = fold.fitness;
+        stored->updated = time(NULL);
+        return true;
+    }
+
+    size_t length = proteinSequence.size();
+    string error;
+    if(!grow(recordSize(length), error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+
+    // Write the record before moving dataEnd past it
+    storeHeader *header = (storeHeader *)map;
+    uint64_t offset = header->dataEnd;
+    storeRecord *stored = recordAt(map, offset);
+    stored->key = key;
+    stored->modelKey = hashBytes(energyModel);
+    stored->updated = time(NULL);
+    stored->fitness = fold.fitness;
+    stored->length = length;
+    memcpy((char *)(stored + 1), proteinSequence.data(), length);
+    memcpy((char *)(stored + 1) + length, fold.proteinDirection.data(), length);
+
+    header->dataEnd = offset + recordSize(length);
+    header->numRecords++;
+    index[key] = offset;
+    return true;
+}
+
+
+
+// Lays sites out one at a time on a random free neighbour of the previous one
+static bool growChain(vector<int> &xs, vector<int> &ys, unordered_set<uint64_t> &occupied, int from, int to, int step) {
+    static const int dx[4] = {0, 1, 0, -1};
+    static const int dy[4] = {-1, 0, 1, 0};
+    for(int i=from;i!=to;i+=step) {
+        int free[4];
+        int numFree = 0;
+        for(int d=0;d<4;d++) {
+            if(occupied.count(packCoordinate(xs[i-step] + dx[d], ys[i-step] + dy[d])) == 0) {
+                free[numFree++] = d;
+            }
+        }
+        if(numFree == 0) {
+            return false;
+        }
+        int d = free[foldRand() % numFree];
+        xs[i] = xs[i-step] + dx[d];
+        ys[i] = ys[i-step] + dy[d];
+        occupied.insert(packCoordinate(xs[i], ys[i]));
+    }
+    return true;
+}
+
+// Lays the stored fold of a piece out at sites offset..offset+pieceLength-1
+static void placePiece(vector<int> &xs, vector<int> &ys, unordered_set<uint64_t> &occupied, int offset, const char *pieceDirection, int pieceLength) {
+    int x = 0;
+    int y = 0;
+    for(int i=0;i<pieceLength;i++) {
+        xs[offset + i] = x;
+        ys[offset + i] = y;
+        occupied.insert(packCoordinate(x, y));
+
+        char direction = pieceDirection[i];
+        if(direction == '1') {
+            y--;
+        } else if(direction == '2') {
+            x++;
+        } else if(direction == '3') {
+            y++;
+        } else if(direction == '4') {
+            x--;
+        }
+    }
+}
+
+// Directional sequence for sites 0..length-1 of proteinSequence, reusing the
+// stored fold of the piece at offset and growing the ends around it
+static bool foldAroundPiece(int length, int offset, const char *pieceDirection, int pieceLength, string &proteinDirection) {
+    vector<int> xs(length);
+    vector<int> ys(length);
+    unordered_set<uint64_t> occupied;
+
+    // Random growth can wall itself in, so it gets a few goes
+    bool grown = false;
+    for(int attempt=0;attempt<growAttempts && !grown;attempt++) {
+        occupied.clear();
+        placePiece(xs, ys, occupied, offset, pieceDirection, pieceLength);
+        grown = growChain(xs, ys, occupied, offset + pieceLength, length, 1) &&
+                growChain(xs, ys, occupied, offset - 1, -1, -1);
+    }
+    if(!grown) {
+        return false;
+    }
+
+    proteinDirection.assign(length, '0');
+    for(int i=0;i<length-1;i++) {
+        int dx = xs[i+1] - xs[i];
+        int dy = ys[i+1] - ys[i];
+        proteinDirection[i] = dy < 0 ? '1' : dx > 0 ? '2' : dy > 0 ? '3' : '4';
+    }
+    return true;
+}
+
+
+vector<string> ResultStore::warmStartSeeds(const string &energyModel, const string &proteinSequence, int maxSeeds) const {
+    vector<string> seeds;
+    if(map == NULL || maxSeeds <= 0) {
+        return seeds;
+    }
+
+    proteinNode exact;
+    if(lookup(energyModel, proteinSequence, exact)) {
+        seeds.push_back(exact.proteinDirection);
+    }
+
+    // Stored sequences that contain this one, or pieces of it of at least a quarter of its length
+    struct overlap {
+        int length;
+        int fitness;
+        uint64_t offset;
+        int position;
+        bool contains;
+    };
+    vector<overlap> overlaps;
+    int length = proteinSequence.size();
+    int minPiece = max(4, length / 4);
+    uint64_t modelKey = hashBytes(energyModel);
+    uint64_t key = sequenceKey(energyModel, proteinSequence);
+    for(unordered_map<uint64_t, uint64_t>::const_iterator it=index.begin();it!=index.end();it++) {
+        storeRecord *stored = recordAt(map, it->second);
+        if(stored->modelKey != modelKey || stored->key == key) {
+            continue;
+        }
+
+        const char *storedSequence = (const char *)(stored + 1);
+        if(stored->length > length) {
+            const char *found = search(storedSequence, storedSequence + stored->length, proteinSequence.begin(), proteinSequence.end());
+            if(found != storedSequence + stored->length) {
+                overlaps.push_back({length, stored->fitness, it->second, (int)(found - storedSequence), true});
+            }
+        } else if(stored->length >= minPiece) {
+            string::const_iterator found = search(proteinSequence.begin(), proteinSequence.end(), storedSequence, storedSequence + stored->length);
+            if(found != proteinSequence.end()) {
+                overlaps.push_back({stored->length, stored->fitness, it->second, (int)(found - proteinSequence.begin()), false});
+            }
+        }
+    }
+    sort(overlaps.begin(), overlaps.end(), [](const overlap &a, const overlap &b) {
+        return a.length != b.length ? a.length > b.length : a.fitness < b.fitness;
+    });
+
+    for(size_t i=0;i<overlaps.size() && (int)seeds.size()<maxSeeds;i++) {
+        storeRecord *stored = recordAt(map, overlaps[i].offset);
+        const char *storedDirection = (const char *)(stored + 1) + stored->length;
+
+        string proteinDirection;
+        if(overlaps[i].contains) {
+            // Any stretch of a self-avoiding walk is one too
+            proteinDirection.assign(storedDirection + overlaps[i].position, length - 1);
+            proteinDirection.push_back('0');
+        } else if(!foldAroundPiece(length, overlaps[i].position, storedDirection, stored->length, proteinDirection)) {
+            continue;
+        }
+        seeds.push_back(proteinDirection);
+    }
+
+    // The engines take seeds as valid walks of this sequence, whatever is in the file
+    vector<string> validSeeds;
+    for(size_t i=0;i<seeds.size();i++) {
+        if(seeds[i].size() == proteinSequence.size() && !collisionDetection(seeds[i], length)) {
+            validSeeds.push_back(seeds[i]);
+        }
+    }
+    return validSeeds;
+}
@@ -0,0 +1,56 @@
+#ifndef RESULTSTORE_H
+#define RESULTSTORE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "folding.h"
+
+// Persistent store of the best fold found for every sequence, so later runs
+// can start from what earlier runs already solved.
+//
+// The file is memory mapped and holds one fixed-size record per sequence and
+// energy model (keyed by a 64-bit hash of both), appended as new sequences
+// come in and overwritten in place when a better fold turns up. The hash ->
+// record index is rebuilt in memory when the store is opened. Only one
+// process can have a store open at a time.
+class ResultStore
+{
+public:
+    ResultStore();
+    ~ResultStore();
+
+    bool open(const std::string &filename, std::string &error);
+    void close();
+    bool isOpen() const { return map != NULL; }
+
+    // Best stored fold of exactly this sequence, false if there is none
+    bool lookup(const std::string &energyModel, const std::string &proteinSequence, proteinNode &best) const;
+
+    // Keeps fold if it beats the stored one (or nothing is stored), returns true if it was kept
+    bool record(const std::string &energyModel, const std::string &proteinSequence, const proteinNode &fold);
+
+    // Up to maxSeeds starting folds for proteinSequence: the stored fold of the
+    // sequence itself, then folds cut out of stored sequences that contain it,
+    // then stored folds of pieces of it with the rest of the chain grown around
+    // them at random. Longest overlaps first. Only self-avoiding walks as
+    // long as proteinSequence are returned, so engines can take them as they are.
+    std::vector<std::string> warmStartSeeds(const std::string &energyModel, const std::string &proteinSequence, int maxSeeds) const;
+
+    int getNumRecords() const { return index.size(); }
+
+private:
+    bool grow(size_t needed, std::string &error);
+
+    std::string filename;
+    int fd;
+    char *map;
+    size_t mapSize;
+
+    // Sequence key -> offset of its record in the file
+    std::unordered_map<uint64_t, uint64_t> index;
+};
+
+#endif // RESULTSTORE_H
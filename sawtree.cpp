@@ -0,0 +1,344 @@
+#include "sawtree.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+
+// Identity, the three rotations, then the four reflections
+const SawTree::latticeSymmetry SawTree::symmetries[SawTree::numSymmetries] = {
+    { 1,  0,  0,  1},
+    { 0, -1,  1,  0},
+    {-1,  0,  0, -1},
+    { 0,  1, -1,  0},
+    {-1,  0,  0,  1},
+    { 1,  0,  0, -1},
+    { 0,  1,  1,  0},
+    { 0, -1, -1,  0}
+};
+
+
+static void directionToBond(char direction, int &x, int &y) {
+    x = 0;
+    y = 0;
+    if(direction == '1') {
+        y = -1;
+    } else if(direction == '2') {
+        x = 1;
+    } else if(direction == '3') {
+        y = 1;
+    } else if(direction == '4') {
+        x = -1;
+    }
+}
+
+static char bondToDirection(int x, int y) {
+    if(y < 0) {
+        return '1';
+    } else if(x > 0) {
+        return '2';
+    } else if(y > 0) {
+        return '3';
+    }
+    return '4';
+}
+
+
+SawTree::latticeSymmetry SawTree::compose(const latticeSymmetry &a, const latticeSymmetry &b) {
+    latticeSymmetry c;
+    c.xx = a.xx * b.xx + a.xy * b.yx;
+    c.xy = a.xx * b.xy + a.xy * b.yy;
+    c.yx = a.yx * b.xx + a.yy * b.yx;
+    c.yy = a.yx * b.xy + a.yy * b.yy;
+    return c;
+}
+
+// The symmetries are orthogonal, so the inverse is the transpose
+SawTree::latticeSymmetry SawTree::inverse(const latticeSymmetry &a) {
+    latticeSymmetry c = {a.xx, a.yx, a.xy, a.yy};
+    return c;
+}
+
+// A lattice symmetry maps opposite corners of a box to opposite corners
+SawTree::sawBox SawTree::transformBox(const sawBox &box, const sawFrame &frame) {
+    const latticeSymmetry &s = frame.symmetry;
+    int x1 = s.xx * box.minX + s.xy * box.minY;
+    int y1 = s.yx * box.minX + s.yy * box.minY;
+    int x2 = s.xx * box.maxX + s.xy * box.maxY;
+    int y2 = s.yx * box.maxX + s.yy * box.maxY;
+
+    sawBox result;
+    result.minX = min(x1, x2) + frame.x;
+    result.maxX = max(x1, x2) + frame.x;
+    result.minY = min(y1, y2) + frame.y;
+    result.maxY = max(y1, y2) + frame.y;
+    return result;
+}
+
+// Whether the boxes overlap once grown by margin (1 to find neighbouring sites)
+bool SawTree::overlaps(const sawBox &a, const sawBox &b, int margin) {
+    return a.minX - margin <= b.maxX && b.minX - margin <= a.maxX &&
+           a.minY - margin <= b.maxY && b.minY - margin <= a.maxY;
+}
+
+SawTree::sawFrame SawTree::childFrame(const sawFrame &frame, const sawNode &node, bool right) const {
+    sawFrame child;
+    if(right) {
+        child.symmetry = compose(frame.symmetry, node.rightSymmetry);
+        child.x = frame.x + frame.symmetry.xx * node.rightX + frame.symmetry.xy * node.rightY;
+        child.y = frame.y + frame.symmetry.yx * node.rightX + frame.symmetry.yy * node.rightY;
+    } else {
+        child.symmetry = compose(frame.symmetry, node.leftSymmetry);
+        child.x = frame.x;
+        child.y = frame.y;
+    }
+    return child;
+}
+
+
+
+void SawTree::build(const contactIndex &hIndex, const string &proteinDirection) {
+    numSites = hIndex.length;
+    numTypes = hIndex.numTypes;
+    pairEnergy = hIndex.pairEnergy;
+    siteTypes = hIndex.siteTypes;
+    nodes.clear();
+    nodes.reserve(2 * numSites);
+    root = buildNode(0, numSites - 1, proteinDirection);
+}
+
+int SawTree::buildNode(int lo, int hi, const string &proteinDirection) {
+    int nodeIndex = nodes.size();
+    nodes.push_back(sawNode());
+
+    sawNode node;
+    node.lo = lo;
+    node.hi = hi;
+    node.leftSymmetry = symmetries[0];
+    node.rightSymmetry = symmetries[0];
+    node.bondX = 0;
+    node.bondY = 0;
+    node.rightX = 0;
+    node.rightY = 0;
+    node.endX = 0;
+    node.endY = 0;
+    node.box.minX = node.box.maxX = node.box.minY = node.box.maxY = 0;
+    node.hBox = node.box;
+
+    if(lo == hi) {
+        node.left = -1;
+        node.right = -1;
+        node.numH = siteTypes[lo] >= 0 ? 1 : 0;
+        nodes[nodeIndex] = node;
+        return nodeIndex;
+    }
+
+    int mid = (lo + hi) / 2;
+    node.left = buildNode(lo, mid, proteinDirection);
+    node.right = buildNode(mid + 1, hi, proteinDirection);
+    directionToBond(proteinDirection[mid], node.bondX, node.bondY);
+    recompute(node);
+
+    nodes[nodeIndex] = node;
+    return nodeIndex;
+}
+
+// Rebuilds a node's summary from its children, O(1)
+void SawTree::recompute(sawNode &node) {
+    const sawNode &left = nodes[node.left];
+    const sawNode &right = nodes[node.right];
+    const latticeSymmetry &ls = node.leftSymmetry;
+    const latticeSymmetry &rs = node.rightSymmetry;
+
+    node.rightX = ls.xx * left.endX + ls.xy * left.endY + node.bondX;
+    node.rightY = ls.yx * left.endX + ls.yy * left.endY + node.bondY;
+    node.endX = node.rightX + rs.xx * right.endX + rs.xy * right.endY;
+    node.endY = node.rightY + rs.yx * right.endX + rs.yy * right.endY;
+
+    sawFrame leftFrame = {ls, 0, 0};
+    sawFrame rightFrame = {rs, node.rightX, node.rightY};
+    sawBox leftBox = transformBox(left.box, leftFrame);
+    sawBox rightBox = transformBox(right.box, rightFrame);
+    node.box.minX = min(leftBox.minX, rightBox.minX);
+    node.box.maxX = max(leftBox.maxX, rightBox.maxX);
+    node.box.minY = min(leftBox.minY, rightBox.minY);
+    node.box.maxY = max(leftBox.maxY, rightBox.maxY);
+
+    node.numH = left.numH + right.numH;
+    if(left.numH > 0 && right.numH > 0) {
+        sawBox leftH = transformBox(left.hBox, leftFrame);
+        sawBox rightH = transformBox(right.hBox, rightFrame);
+        node.hBox.minX = min(leftH.minX, rightH.minX);
+        node.hBox.maxX = max(leftH.maxX, rightH.maxX);
+        node.hBox.minY = min(leftH.minY, rightH.minY);
+        node.hBox.maxY = max(leftH.maxY, rightH.maxY);
+    } else if(left.numH > 0) {
+        node.hBox = transformBox(left.hBox, leftFrame);
+    } else if(right.numH > 0) {
+        node.hBox = transformBox(right.hBox, rightFrame);
+    }
+}
+
+
+
+// Splits the chain at site into whole sub-walks before and after it, with their world frames
+void SawTree::collect(int nodeIndex, const sawFrame &frame, int site, vector<pair<int, sawFrame>> &prefix,
+                      vector<pair<int, sawFrame>> &suffix) const {
+    const sawNode &node = nodes[nodeIndex];
+    if(node.hi <= site) {
+        prefix.push_back(make_pair(nodeIndex, frame));
+    } else if(node.lo > site) {
+        suffix.push_back(make_pair(nodeIndex, frame));
+    } else {
+        collect(node.left, childFrame(frame, node, false), site, prefix, suffix);
+        collect(node.right, childFrame(frame, node, true), site, prefix, suffix);
+    }
+}
+
+// Whether two sub-walks share a site, opening up the larger one while their boxes overlap
+bool SawTree::intersects(int a, const sawFrame &frameA, int b, const sawFrame &frameB) const {
+    const sawNode &nodeA = nodes[a];
+    const sawNode &nodeB = nodes[b];
+    if(!overlaps(transformBox(nodeA.box, frameA), transformBox(nodeB.box, frameB), 0)) {
+        return false;
+    }
+
+    bool leafA = nodeA.left < 0;
+    bool leafB = nodeB.left < 0;
+    if(leafA && leafB) {
+        return true;
+    }
+
+    if(leafB || (!leafA && nodeA.hi - nodeA.lo >= nodeB.hi - nodeB.lo)) {
+        return intersects(nodeA.left, childFrame(frameA, nodeA, false), b, frameB) ||
+               intersects(nodeA.right, childFrame(frameA, nodeA, true), b, frameB);
+    }
+    return intersects(a, frameA, nodeB.left, childFrame(frameB, nodeB, false)) ||
+           intersects(a, frameA, nodeB.right, childFrame(frameB, nodeB, true));
+}
+
+// Energy of the contacts between two sub-walks
+int SawTree::contactEnergy(int a, const sawFrame &frameA, int b, const sawFrame &frameB) const {
+    const sawNode &nodeA = nodes[a];
+    const sawNode &nodeB = nodes[b];
+    if(nodeA.numH == 0 || nodeB.numH == 0) {
+        return 0;
+    }
+    if(!overlaps(transformBox(nodeA.hBox, frameA), transformBox(nodeB.hBox, frameB), 1)) {
+        return 0;
+    }
+
+    bool leafA = nodeA.left < 0;
+    bool leafB = nodeB.left < 0;
+    if(leafA && leafB) {
+        if(abs(frameA.x - frameB.x) + abs(frameA.y - frameB.y) != 1) {
+            return 0;
+        }
+        return pairEnergy[siteTypes[nodeA.lo] * numTypes + siteTypes[nodeB.lo]];
+    }
+
+    if(leafB || (!leafA && nodeA.hi - nodeA.lo >= nodeB.hi - nodeB.lo)) {
+        return contactEnergy(nodeA.left, childFrame(frameA, nodeA, false), b, frameB) +
+               contactEnergy(nodeA.right, childFrame(frameA, nodeA, true), b, frameB);
+    }
+    return contactEnergy(a, frameA, nodeB.left, childFrame(frameB, nodeB, false)) +
+           contactEnergy(a, frameA, nodeB.right, childFrame(frameB, nodeB, true));
+}
+
+
+bool SawTree::testPivot(int site, int symmetry, int &fitnessChange) const {
+    prefixNodes.clear();
+    suffixNodes.clear();
+    movedNodes.clear();
+
+    sawFrame world = {symmetries[0], 0, 0};
+    collect(root, world, site, prefixNodes, suffixNodes);
+
+    // The pivot site is the last site of the last prefix sub-walk
+    const sawNode &last = nodes[prefixNodes.back().first];
+    const sawFrame &lastFrame = prefixNodes.back().second;
+    int pivotX = lastFrame.x + lastFrame.symmetry.xx * last.endX + lastFrame.symmetry.xy * last.endY;
+    int pivotY = lastFrame.y + lastFrame.symmetry.yx * last.endX + lastFrame.symmetry.yy * last.endY;
+
+    // Suffix frames after turning them about the pivot site
+    const latticeSymmetry &g = symmetries[symmetry];
+    for(size_t i=0;i<suffixNodes.size();i++) {
+        const sawFrame &frame = suffixNodes[i].second;
+        sawFrame moved;
+        moved.symmetry = compose(g, frame.symmetry);
+        moved.x = pivotX + g.xx * (frame.x - pivotX) + g.xy * (frame.y - pivotY);
+        moved.y = pivotY + g.yx * (frame.x - pivotX) + g.yy * (frame.y - pivotY);
+        movedNodes.push_back(make_pair(suffixNodes[i].first, moved));
+    }
+
+    for(size_t i=0;i<prefixNodes.size();i++) {
+        for(size_t j=0;j<movedNodes.size();j++) {
+            if(intersects(prefixNodes[i].first, prefixNodes[i].second, movedNodes[j].first, movedNodes[j].second)) {
+                return false;
+            }
+        }
+    }
+
+    // Contacts inside either part do not change, only the ones across the pivot
+    int energyBefore = 0;
+    int energyAfter = 0;
+    for(size_t i=0;i<prefixNodes.size();i++) {
+        for(size_t j=0;j<movedNodes.size();j++) {
+            energyBefore += contactEnergy(prefixNodes[i].first, prefixNodes[i].second, suffixNodes[j].first, suffixNodes[j].second);
+            energyAfter += contactEnergy(prefixNodes[i].first, prefixNodes[i].second, movedNodes[j].first, movedNodes[j].second);
+        }
+    }
+    fitnessChange = energyAfter - energyBefore;
+    return true;
+}
+
+
+void SawTree::applyPivot(int site, int symmetry) {
+    pivotSuffix(root, site, symmetries[symmetry]);
+}
+
+// Turns every bond from site on by symmetry (given in this node's frame), then fixes up the path back to the root
+void SawTree::pivotSuffix(int nodeIndex, int site, const latticeSymmetry &symmetry) {
+    sawNode &node = nodes[nodeIndex];
+    if(site >= node.hi) {
+        return;
+    }
+
+    int mid = nodes[node.left].hi;
+    if(site <= mid) {
+        node.rightSymmetry = compose(symmetry, node.rightSymmetry);
+        int bondX = symmetry.xx * node.bondX + symmetry.xy * node.bondY;
+        int bondY = symmetry.yx * node.bondX + symmetry.yy * node.bondY;
+        node.bondX = bondX;
+        node.bondY = bondY;
+        if(site < mid) {
+            pivotSuffix(node.left, site, compose(inverse(node.leftSymmetry), compose(symmetry, node.leftSymmetry)));
+        }
+    } else {
+        pivotSuffix(node.right, site, compose(inverse(node.rightSymmetry), compose(symmetry, node.rightSymmetry)));
+    }
+
+    recompute(node);
+}
+
+
+string SawTree::getDirections() const {
+    string proteinDirection;
+    proteinDirection.reserve(numSites);
+    appendDirections(root, symmetries[0], proteinDirection);
+    proteinDirection.push_back('0');
+    return proteinDirection;
+}
+
+void SawTree::appendDirections(int nodeIndex, const latticeSymmetry &symmetry, string &proteinDirection) const {
+    const sawNode &node = nodes[nodeIndex];
+    if(node.left < 0) {
+        return;
+    }
+
+    appendDirections(node.left, compose(symmetry, node.leftSymmetry), proteinDirection);
+    proteinDirection.push_back(bondToDirection(symmetry.xx * node.bondX + symmetry.xy * node.bondY,
+                                               symmetry.yx * node.bondX + symmetry.yy * node.bondY));
+    appendDirections(node.right, compose(symmetry, node.rightSymmetry), proteinDirection);
+}
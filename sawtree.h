@@ -0,0 +1,105 @@
+#ifndef SAWTREE_H
+#define SAWTREE_H
+
+#include <string>
+#include <vector>
+
+#include "contactindex.h"
+
+// Self-avoiding walk tree (after Clisby's SAW-tree) for pivot moves on long chains.
+//
+// The chain is kept as a balanced binary tree over its sites. Every node
+// stores its sub-walk in its own frame: the bounding box of its sites and of
+// its contact residues (the H sites for HP), where its last site ends up,
+// and the lattice symmetry and bond that place its two children. A pivot
+// (turning every site after some site about it by a rotation or reflection)
+// then only touches the nodes on one root-to-leaf path, and checking the
+// pivoted walk for collisions or scoring the contacts that change compares
+// bounding boxes of whole sub-walks, only going down where they overlap.
+//
+// Positions use the same directions as the rest of the program:
+// 1=North (y-1) 2=East (x+1) 3=South (y+1) 4=West (x-1), 0 at the end.
+class SawTree
+{
+public:
+    // Number of pivot symmetries, symmetry 0 is the identity
+    static const int numSymmetries = 8;
+
+    // proteinDirection must be a self-avoiding walk for the sequence of hIndex
+    void build(const contactIndex &hIndex, const std::string &proteinDirection);
+
+    int size() const { return numSites; }
+
+    // Checks pivoting every site after site by symmetry (1-7) about it. Returns
+    // false if the walk would collide with itself, otherwise sets fitnessChange
+    // to the change in contact energy.
+    bool testPivot(int site, int symmetry, int &fitnessChange) const;
+    void applyPivot(int site, int symmetry);
+
+    std::string getDirections() const;
+
+private:
+    // 2x2 integer matrix of one of the 8 symmetries of the square lattice
+    struct latticeSymmetry {
+        int xx, xy, yx, yy;
+    };
+
+    struct sawBox {
+        int minX, maxX, minY, maxY;
+    };
+
+    // Maps a node's own coordinates into the world (or a parent) frame
+    struct sawFrame {
+        latticeSymmetry symmetry;
+        int x, y;
+    };
+
+    struct sawNode {
+        int lo, hi;
+        // Children, -1 for a leaf (a single site)
+        int left, right;
+        // Where the children sit in this node's frame, and the bond joining them
+        latticeSymmetry leftSymmetry, rightSymmetry;
+        int bondX, bondY;
+        int rightX, rightY;
+        // Last site of the sub-walk, its first site is the origin
+        int endX, endY;
+        sawBox box;
+        // Box of the contact residues, only set if there are any
+        sawBox hBox;
+        int numH;
+    };
+
+    int buildNode(int lo, int hi, const std::string &proteinDirection);
+    void recompute(sawNode &node);
+    void pivotSuffix(int nodeIndex, int site, const latticeSymmetry &symmetry);
+
+    void collect(int nodeIndex, const sawFrame &frame, int site, std::vector<std::pair<int, sawFrame>> &prefix,
+                 std::vector<std::pair<int, sawFrame>> &suffix) const;
+    bool intersects(int a, const sawFrame &frameA, int b, const sawFrame &frameB) const;
+    int contactEnergy(int a, const sawFrame &frameA, int b, const sawFrame &frameB) const;
+    void appendDirections(int nodeIndex, const latticeSymmetry &symmetry, std::string &proteinDirection) const;
+
+    sawFrame childFrame(const sawFrame &frame, const sawNode &node, bool right) const;
+
+    static latticeSymmetry compose(const latticeSymmetry &a, const latticeSymmetry &b);
+    static latticeSymmetry inverse(const latticeSymmetry &a);
+    static sawBox transformBox(const sawBox &box, const sawFrame &frame);
+    static bool overlaps(const sawBox &a, const sawBox &b, int margin);
+
+    static const latticeSymmetry symmetries[numSymmetries];
+
+    int numSites;
+    int numTypes;
+    std::vector<int> pairEnergy;
+    std::vector<int> siteTypes;
+    int root;
+    std::vector<sawNode> nodes;
+
+    // Scratch for testPivot
+    mutable std::vector<std::pair<int, sawFrame>> prefixNodes;
+    mutable std::vector<std::pair<int, sawFrame>> suffixNodes;
+    mutable std::vector<std::pair<int, sawFrame>> movedNodes;
+};
+
+#endif // SAWTREE_H
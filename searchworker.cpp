@@ -0,0 +1,226 @@
+#include "searchworker.h"
+#include "proteinrenderer.h"
+#include "perfcounters.h"
+#include "memorybudget.h"
+
+#include <QtDebug>
+#include <climits>
+
+using namespace std;
+
+
+SearchWorker::SearchWorker(const searchSettings &settings, SequenceStream &inputStream, ResultStore &resultStore) :
+    settings(settings),
+    inputStream(inputStream),
+    resultStore(resultStore),
+    stopRequested(false),
+    numCompleted(0)
+{
+}
+
+SearchWorker::~SearchWorker() {
+    stop();
+}
+
+void SearchWorker::start() {
+    stopRequested.store(false);
+    worker = thread(&SearchWorker::run, this);
+}
+
+void SearchWorker::stop() {
+    stopRequested.store(true);
+    if(worker.joinable()) {
+        worker.join();
+    }
+}
+
+
+void SearchWorker::run() {
+    // Does the search for every test case in input file
+    sequenceCase testCase;
+    while(!stopRequested.load() && inputStream.next(testCase)) {
+        runCase(testCase);
+    }
+
+    searchSnapshot &last = slot.back();
+    last.numCompleted = numCompleted;
+    last.finished = true;
+    slot.publish();
+}
+
+void SearchWorker::runCase(const sequenceCase &testCase) {
+    const foldingOptions &options = settings.options;
+    const string &proteinSequence = testCase.sequence;
+    int targetFitness = testCase.targetFitness;
+
+    // Frames go into one sub directory per test case
+    AsyncRenderer frameRenderer;
+    if(settings.renderFrames == 1) {
+        string caseDirectory = settings.frameDirectory + "/case_" + to_string(testCase.index + 1);
+        string renderError;
+        if(!frameRenderer.start(caseDirectory, settings.pixelSpacing, settings.maxFrameRate, renderError)) {
+            qDebug(renderError.c_str());
+        }
+    }
+    // If the targetFitness is 0 or higher, it will run infinitely
+    if(targetFitness >= 0) {
+        targetFitness = INT_MIN;
+    }
+
+    // Print out the test case
+    string seqOutput1 = "Sequence: " + proteinSequence;
+    string seqOutput2 = "Target Fitness: " + to_string(targetFitness);
+
+    qDebug("------- NEW SEQUENCE --------");
+    qDebug(seqOutput1.c_str());
+    qDebug(seqOutput2.c_str());
+    qDebug("-----------------------------");
+    qDebug("");
+
+    qDebug("Loading First Generation...");
+    qDebug("");
+
+    // Generate, score and sort the initial population (or replicas, see the engine option).
+    // main() has already checked the engine name.
+    unique_ptr<FoldingEngine> engine = createEngine(options.engine, proteinSequence, targetFitness, options);
+    // The GA has a population to report on, the other engines only a best fold
+    GeneticEngine *geneticEngine = dynamic_cast<GeneticEngine *>(engine.get());
+
+    // Warm start from earlier runs of this sequence (or of ones overlapping it)
+    vector<string> seeds = resultStore.warmStartSeeds(options.energyModel, proteinSequence, settings.warmStartSeeds);
+    if(!seeds.empty()) {
+        engine->seedFolds(seeds);
+        string seedText = "Warm start: " + to_string(seeds.size()) + " stored folds, best fitness " + to_string(engine->best().fitness);
+        qDebug(seedText.c_str());
+        qDebug("");
+    }
+    int storedFitness = INT_MAX;
+
+    profileSnapshot caseProfile;
+    profileSnapshot lastProfile;
+    if(settings.profileCounters > 0) {
+        takeProfileSnapshot(caseProfile);
+        lastProfile = caseProfile;
+    }
+
+    while(!engine->isSolved()) {
+        if(stopRequested.load()) {
+            frameRenderer.stop();
+            return;
+        }
+        engine->step();
+
+        const proteinNode &best = engine->best();
+        int generationNum = engine->generation();
+
+        if(geneticEngine != NULL && geneticEngine->lastApocalypse()) {
+            qDebug("---------------------- Oh no an APOCALYPSE!!! -----------------------");
+            qDebug("----The pop didn't evolve for X cycles, so a new one grew beside it----");
+            qDebug("----------------- Now they fight it out for the spots ----------------");
+            qDebug("");
+
+            if(geneticEngine->lastSurvivor()) {
+                qDebug(" !!! The old champion survived !!! ");
+                qDebug("");
+            }
+        } else {
+            if(geneticEngine != NULL && geneticEngine->lastDuplicatesRemoved() >= 0) {
+                string duplicateText = " !!! Number of Duplicates Removed: " + to_string(geneticEngine->lastDuplicatesRemoved()) + " !!! ";
+                qDebug(duplicateText.c_str());
+                qDebug("");
+            }
+
+            // Display stats in console
+            string generation = "-------------- Generation: " + to_string(generationNum) + " --------------";
+            string currentFitString = "Fitness:    " + to_string(best.fitness) + " / " + to_string(targetFitness);
+            string currentDirections = "Directions: " + best.proteinDirection;
+            string currentSequence = "Sequence:   " + proteinSequence;
+            string currentFinished = "------ (Done: " + to_string(numCompleted) + ") ------";
+            if(geneticEngine != NULL) {
+                currentFitString += "   TopFit: " + to_string(geneticEngine->getTopFitness());
+                if(geneticEngine->lastNiches() >= 0) {
+                    currentFitString += "   Niches: " + to_string(geneticEngine->lastNiches());
+                }
+                currentFinished = "------ (Done: " + to_string(numCompleted) + "  Apoc: " + to_string(geneticEngine->getNumApoc()) + "  Survivors: " + to_string(geneticEngine->getNumSurvivors()) + ") ------";
+            }
+
+            qDebug(generation.c_str());
+            qDebug(currentFitString.c_str());
+            qDebug(currentDirections.c_str());
+            qDebug(currentSequence.c_str());
+            qDebug(currentFinished.c_str());
+            if(geneticEngine != NULL && !geneticEngine->lastOperatorReport().empty()) {
+                qDebug(geneticEngine->lastOperatorReport().c_str());
+            }
+
+            qDebug("");
+        }
+
+        if(settings.profileCounters > 0 && generationNum % settings.profileCounters == 0) {
+            profileSnapshot nowProfile;
+            takeProfileSnapshot(nowProfile);
+            string profileText = "Counters, generation " + to_string(generationNum) + ":\n" + formatProfile(nowProfile, lastProfile) + "\n" + formatMemory();
+            qDebug(profileText.c_str());
+            qDebug("");
+            lastProfile = nowProfile;
+        }
+
+        // Keep every improvement, so an interrupted run still leaves its best behind
+        if(best.fitness < storedFitness) {
+            resultStore.record(options.energyModel, proteinSequence, best);
+            storedFitness = best.fitness;
+        }
+
+        // Hand the best fit to the frame renderer, skipped if it is busy or unchanged
+        frameRenderer.submit(proteinSequence, best.proteinDirection, best.fitness, generationNum);
+
+        // Hand the window its fold. If drawRand == 1, one from the top of the population.
+        if(settings.drawRand == 1 && geneticEngine != NULL) {
+            const vector<proteinNode> &population = geneticEngine->getPopulation();
+            int randIndex = foldRand() % max(1, (int)(options.popNum * (settings.drawPercentage/100.0)));
+            publish(proteinSequence, population[randIndex], targetFitness, generationNum, false);
+        } else {
+            publish(proteinSequence, best, targetFitness, generationNum, false);
+        }
+    }
+    frameRenderer.stop();
+
+    if(settings.profileCounters > 0) {
+        profileSnapshot nowProfile;
+        takeProfileSnapshot(nowProfile);
+        string profileText = "Counters, whole sequence:\n" + formatProfile(nowProfile, caseProfile) + "\n" + formatMemory();
+        qDebug(profileText.c_str());
+    }
+
+    numCompleted++;
+
+
+    qDebug("");
+    qDebug("");
+    qDebug("");
+    qDebug("");
+    qDebug("");
+    qDebug("");
+    qDebug("---------------------- Pinnacle Evolution: Achieved -----------------------");
+    qDebug("-------------- We have surpassed all that can be surpassed.  --------------");
+    qDebug("----------------- Time to create new life from scratch... -----------------");
+    qDebug("");
+    qDebug("");
+    qDebug("");
+    qDebug("");
+    qDebug("");
+    qDebug("");
+}
+
+void SearchWorker::publish(const string &proteinSequence, const proteinNode &shown, int targetFitness, int generation, bool finished) {
+    // Assigned rather than rebuilt, so the buffers keep their capacity
+    searchSnapshot &next = slot.back();
+    next.proteinSequence.assign(proteinSequence);
+    next.proteinDirection.assign(shown.proteinDirection);
+    next.fitness = shown.fitness;
+    next.targetFitness = targetFitness;
+    next.generation = generation;
+    next.numCompleted = numCompleted;
+    next.finished = finished;
+    slot.publish();
+}
@@ -0,0 +1,76 @@
+#ifndef SEARCHWORKER_H
+#define SEARCHWORKER_H
+
+#include <string>
+#include <thread>
+#include <atomic>
+
+#include "foldingengine.h"
+#include "sequencestream.h"
+#include "resultstore.h"
+#include "snapshotslot.h"
+
+// What the GUI run needs besides the search options, read from Options.txt in main()
+struct searchSettings {
+    foldingOptions options;
+
+    // Show one of the top drawPercentage of the population instead of the best
+    int drawRand = 0;
+    int drawPercentage = 10;
+
+    // Numbered PNG frames of every test case, see AsyncRenderer
+    int renderFrames = 0;
+    std::string frameDirectory = "frames";
+    int maxFrameRate = 10;
+    int pixelSpacing = 25;
+
+    // Counter tables every profileCounters generations, 0 for none
+    int profileCounters = 0;
+
+    int warmStartSeeds = 20;
+};
+
+// The fold shown in the window, published once per generation
+struct searchSnapshot {
+    std::string proteinSequence;
+    std::string proteinDirection;
+    int fitness;
+    int targetFitness;
+    int generation;
+    int numCompleted;
+    // Set on the last snapshot, once every test case is done
+    bool finished;
+};
+
+// Runs every test case of the input on its own thread, so the GUI thread
+// only paints. Console output, the results store, frame rendering and
+// profiling all happen here; the window polls snapshots() for what to show.
+class SearchWorker
+{
+public:
+    SearchWorker(const searchSettings &settings, SequenceStream &inputStream, ResultStore &resultStore);
+    ~SearchWorker();
+
+    void start();
+    // Stops after the current generation and waits for the thread
+    void stop();
+
+    SnapshotSlot<searchSnapshot> &snapshots() { return slot; }
+
+private:
+    void run();
+    void runCase(const sequenceCase &testCase);
+    void publish(const std::string &proteinSequence, const proteinNode &shown, int targetFitness, int generation, bool finished);
+
+    searchSettings settings;
+    SequenceStream &inputStream;
+    ResultStore &resultStore;
+
+    std::thread worker;
+    std::atomic<bool> stopRequested;
+    int numCompleted;
+
+    SnapshotSlot<searchSnapshot> slot;
+};
+
+#endif // SEARCHWORKER_H
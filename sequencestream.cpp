@@ -0,0 +1,404 @@
+#include "sequencestream.h"
+
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+// Read size for pipes, grows if a single line is longer than this
+static const size_t streamChunkSize = 1 << 20;
+
+
+// HELPER FUNCTIONS
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// A sequence line is made only of residue letters
+static bool isSequenceLine(const char *line, size_t length) {
+    if(length == 0) {
+        return false;
+    }
+    for(size_t i=0;i<length;i++) {
+        char c = line[i];
+        if(!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void appendLower(string &out, const char *line, size_t length) {
+    for(size_t i=0;i<length;i++) {
+        char c = line[i];
+        if(c >= 'A' && c <= 'Z') {
+            c = c - 'A' + 'a';
+        }
+        out.push_back(c);
+    }
+}
+
+// Parses a whole token as an integer. The input is not null-terminated
+// (it points into the mapping), so strtol can not be used here.
+static bool parseInt(const char *token, size_t length, int &value) {
+    size_t i = 0;
+    bool negative = false;
+    if(i < length && (token[i] == '-' || token[i] == '+')) {
+        negative = token[i] == '-';
+        i++;
+    }
+    if(i == length) {
+        return false;
+    }
+
+    long result = 0;
+    for(;i<length;i++) {
+        if(token[i] < '0' || token[i] > '9') {
+            return false;
+        }
+        result = result * 10 + (token[i] - '0');
+    }
+    value = negative ? -result : result;
+    return true;
+}
+
+static bool tokenEquals(const char *token, size_t length, const char *text) {
+    return strlen(text) == length && memcmp(token, text, length) == 0;
+}
+
+// Grabs the next whitespace separated token, advancing line/length past it
+static bool nextToken(const char *&line, size_t &length, const char *&token, size_t &tokenLength) {
+    while(length > 0 && isSpace(*line)) {
+        line++;
+        length--;
+    }
+    if(length == 0) {
+        return false;
+    }
+    token = line;
+    while(length > 0 && !isSpace(*line)) {
+        line++;
+        length--;
+    }
+    tokenLength = line - token;
+    return true;
+}
+
+
+SequenceStream::SequenceStream() :
+    mapped(NULL),
+    mappedSize(0),
+    fd(-1),
+    ownsFd(false),
+    bufferStart(0),
+    bufferEnd(0),
+    endOfFile(false),
+    position(0),
+    havePending(false),
+    pendingLine(NULL),
+    pendingLength(0),
+    numRead(0)
+{
+}
+
+SequenceStream::~SequenceStream()
+{
+    close();
+}
+
+
+bool SequenceStream::open(const string &filename, string &error) {
+    close();
+
+    if(filename == "-") {
+        fd = STDIN_FILENO;
+        ownsFd = false;
+        buffer.resize(streamChunkSize);
+        return true;
+    }
+
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0) {
+        error = "Error opening file: " + filename + "\n" + "ERROR: " + strerror(errno);
+        return false;
+    }
+    ownsFd = true;
+
+    // Regular files get mapped, the kernel reads ahead while we parse and fold
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode)) {
+        if(fileStat.st_size == 0) {
+            endOfFile = true;
+            return true;
+        }
+
+        void *map = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map != MAP_FAILED) {
+            madvise(map, fileStat.st_size, MADV_SEQUENTIAL);
+            mapped = (const char *)map;
+            mappedSize = fileStat.st_size;
+
+            ::close(fd);
+            fd = -1;
+            ownsFd = false;
+            return true;
+        }
+    }
+
+    // Anything that can not be mapped is read in chunks
+    buffer.resize(streamChunkSize);
+    return true;
+}
+
+
+void SequenceStream::close() {
+    if(mapped != NULL) {
+        munmap((void *)mapped, mappedSize);
+    }
+    if(ownsFd && fd >= 0) {
+        ::close(fd);
+    }
+
+    mapped = NULL;
+    mappedSize = 0;
+    fd = -1;
+    ownsFd = false;
+    bufferStart = 0;
+    bufferEnd = 0;
+    endOfFile = false;
+    position = 0;
+    havePending = false;
+    numRead = 0;
+}
+
+
+// Moves the unread tail of the buffer to the front and reads more behind it.
+// Invalidates any line previously handed out from the buffer.
+bool SequenceStream::fillBuffer() {
+    if(endOfFile) {
+        return false;
+    }
+
+    size_t remaining = bufferEnd - bufferStart;
+    if(bufferStart > 0) {
+        memmove(buffer.data(), buffer.data() + bufferStart, remaining);
+        bufferStart = 0;
+        bufferEnd = remaining;
+    }
+    if(bufferEnd == buffer.size()) {
+        buffer.resize(buffer.size() * 2);
+    }
+
+    ssize_t numBytes;
+    do {
+        numBytes = read(fd, buffer.data() + bufferEnd, buffer.size() - bufferEnd);
+    } while(numBytes < 0 && errno == EINTR);
+
+    if(numBytes <= 0) {
+        endOfFile = true;
+        return false;
+    }
+    bufferEnd += numBytes;
+    return true;
+}
+
+
+// Hands out the next line as a view, without the trailing newline
+bool SequenceStream::nextLine(const char *&line, size_t &length) {
+    if(havePending) {
+        havePending = false;
+        line = pendingLine;
+        length = pendingLength;
+        return true;
+    }
+
+    if(mapped != NULL || (fd < 0 && endOfFile)) {
+        if(position >= mappedSize) {
+            return false;
+        }
+        line = mapped + position;
+        const char *newline = (const char *)memchr(line, '\n', mappedSize - position);
+        if(newline == NULL) {
+            length = mappedSize - position;
+            position = mappedSize;
+        } else {
+            length = newline - line;
+            position += length + 1;
+        }
+        return true;
+    }
+
+    while(true) {
+        const char *start = buffer.data() + bufferStart;
+        const char *newline = (const char *)memchr(start, '\n', bufferEnd - bufferStart);
+        if(newline != NULL) {
+            line = start;
+            length = newline - start;
+            bufferStart += length + 1;
+            return true;
+        }
+
+        if(!fillBuffer()) {
+            // Last line without a newline
+            if(bufferEnd > bufferStart) {
+                line = buffer.data() + bufferStart;
+                length = bufferEnd - bufferStart;
+                bufferStart = bufferEnd;
+                return true;
+            }
+            return false;
+        }
+    }
+}
+
+
+bool SequenceStream::next(sequenceCase &testCase) {
+    const char *line;
+    size_t length;
+
+    // Headers with no residues are skipped, in a loop so a long run of them cannot overflow the stack
+    while(true) {
+        testCase.name.clear();
+        testCase.sequence.clear();
+        testCase.targetFitness = 0;
+
+        bool inRecord = false;
+        bool fasta = false;
+
+        while(nextLine(line, length)) {
+            const char *rawLine = line;
+            size_t rawLength = length;
+
+            // Trim whitespace on both ends
+            while(length > 0 && isSpace(*line)) {
+                line++;
+                length--;
+            }
+            while(length > 0 && isSpace(line[length-1])) {
+                length--;
+            }
+
+            // Blank lines close a FASTA record, otherwise they are ignored
+            if(length == 0) {
+                if(inRecord && fasta && !testCase.sequence.empty()) {
+                    break;
+                }
+                continue;
+            }
+
+            // Comments
+            if(line[0] == '#' || line[0] == ';') {
+                continue;
+            }
+
+            // FASTA header: ">name [fitness]" or ">name fitness=N"
+            if(line[0] == '>') {
+                if(inRecord && !testCase.sequence.empty()) {
+                    havePending = true;
+                    pendingLine = rawLine;
+                    pendingLength = rawLength;
+                    break;
+                }
+
+                testCase.name.clear();
+                testCase.sequence.clear();
+                testCase.targetFitness = 0;
+                inRecord = true;
+                fasta = true;
+
+                const char *rest = line + 1;
+                size_t restLength = length - 1;
+                const char *token;
+                size_t tokenLength;
+                if(nextToken(rest, restLength, token, tokenLength)) {
+                    testCase.name.assign(token, tokenLength);
+                }
+                while(nextToken(rest, restLength, token, tokenLength)) {
+                    const char *equals = (const char *)memchr(token, '=', tokenLength);
+                    if(equals != NULL) {
+                        tokenLength -= (equals + 1) - token;
+                        token = equals + 1;
+                    }
+                    parseInt(token, tokenLength, testCase.targetFitness);
+                }
+                continue;
+            }
+
+            // Continuation lines of a FASTA record
+            if(inRecord && fasta && isSequenceLine(line, length)) {
+                appendLower(testCase.sequence, line, length);
+                continue;
+            }
+
+            // Bare sequence, one per line
+            if(isSequenceLine(line, length)) {
+                if(inRecord && !testCase.sequence.empty()) {
+                    havePending = true;
+                    pendingLine = rawLine;
+                    pendingLength = rawLength;
+                    break;
+                }
+                appendLower(testCase.sequence, line, length);
+                inRecord = true;
+                break;
+            }
+
+            // Legacy "Key = Value" lines
+            const char *rest = line;
+            size_t restLength = length;
+            const char *key = line;
+            size_t keyLength = 0;
+            while(keyLength < restLength && !isSpace(key[keyLength]) && key[keyLength] != '=') {
+                keyLength++;
+            }
+            rest += keyLength;
+            restLength -= keyLength;
+            while(restLength > 0 && (isSpace(*rest) || *rest == '=')) {
+                rest++;
+                restLength--;
+            }
+            const char *value;
+            size_t valueLength;
+            if(!nextToken(rest, restLength, value, valueLength)) {
+                continue;
+            }
+
+            if(tokenEquals(key, keyLength, "Seq")) {
+                if(inRecord && !testCase.sequence.empty()) {
+                    havePending = true;
+                    pendingLine = rawLine;
+                    pendingLength = rawLength;
+                    break;
+                }
+                testCase.sequence.clear();
+                appendLower(testCase.sequence, value, valueLength);
+                inRecord = true;
+                fasta = false;
+            } else if(tokenEquals(key, keyLength, "Fitness")) {
+                // Fitness always closes the record it belongs to
+                if(inRecord) {
+                    parseInt(value, valueLength, testCase.targetFitness);
+                    break;
+                }
+            }
+            // Anything else (e.g. "Number of cases") is skipped
+        }
+
+        if(inRecord && !testCase.sequence.empty()) {
+            break;
+        }
+        if(!inRecord) {
+            return false;
+        }
+    }
+
+    testCase.index = numRead++;
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef SEQUENCESTREAM_H
+#define SEQUENCESTREAM_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// One test case pulled from the input stream. The strings are reused between
+// calls to SequenceStream::next() so their capacity is only paid for once.
+struct sequenceCase {
+    std::string name;
+    std::string sequence;
+    int targetFitness;
+    long index;
+};
+
+// Streams test cases out of an input file without loading the whole file.
+//
+// Regular files are memory-mapped and read front to back, pipes (and "-" for
+// stdin) fall back to a growable read buffer. Lines are handed around as
+// pointer/length views into the mapping or buffer, so parsing does not
+// allocate per line.
+//
+// Accepted formats, which may be mixed in one file:
+//   Legacy Input.txt:  "Number of cases = N" (optional, ignored)
+//                      "Seq = hphpph..."
+//                      "Fitness = -9"
+//   FASTA style:       ">name -9" or ">name fitness=-9", followed by one or
+//                      more sequence lines until the next '>' or blank line
+//   Bare sequences:    one "hphpph..." per line
+//
+// Sequences are lowercased so 'H'/'P' files work with the 'h' checks.
+// Lines that match none of the above are skipped instead of aborting.
+class SequenceStream
+{
+public:
+    SequenceStream();
+    ~SequenceStream();
+
+    bool open(const std::string &filename, std::string &error);
+    void close();
+
+    // Fills the next test case, returns false once the input is exhausted
+    bool next(sequenceCase &testCase);
+
+private:
+    bool nextLine(const char *&line, size_t &length);
+    bool fillBuffer();
+
+    // Memory-mapped input
+    const char *mapped;
+    size_t mappedSize;
+
+    // Buffered input (pipes/stdin)
+    int fd;
+    bool ownsFd;
+    std::vector<char> buffer;
+    size_t bufferStart;
+    size_t bufferEnd;
+    bool endOfFile;
+
+    size_t position;
+
+    // A line read ahead while collecting a multi-line FASTA record
+    bool havePending;
+    const char *pendingLine;
+    size_t pendingLength;
+
+    long numRead;
+};
+
+#endif // SEQUENCESTREAM_H
@@ -0,0 +1,56 @@
+#ifndef SNAPSHOTSLOT_H
+#define SNAPSHOTSLOT_H
+
+#include <atomic>
+
+// Lock-free single-producer/single-consumer slot holding the latest value
+// (a triple buffer). The producer fills back() and publish()es it, the
+// consumer calls update() whenever it likes and reads front(). Neither side
+// ever waits: values published in between reads are simply overwritten, and
+// buffers are reused, so a T made of strings stops allocating once their
+// capacity has grown.
+template<typename T>
+class SnapshotSlot
+{
+public:
+    SnapshotSlot() :
+        middle(1),
+        backIndex(2),
+        frontIndex(0)
+    {
+    }
+
+    // Producer side
+    T &back() { return buffers[backIndex]; }
+    void publish() {
+        int previous = middle.exchange(backIndex | freshBit, std::memory_order_acq_rel);
+        backIndex = previous & indexMask;
+    }
+
+    // Consumer side: true if something was published since the last update(),
+    // front() is then the newest value
+    bool update() {
+        if((middle.load(std::memory_order_relaxed) & freshBit) == 0) {
+            return false;
+        }
+        int previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & indexMask;
+        return true;
+    }
+    const T &front() const { return buffers[frontIndex]; }
+
+private:
+    static const int indexMask = 3;
+    static const int freshBit = 4;
+
+    T buffers[3];
+
+    // Index of the buffer between the two sides, plus freshBit when it holds
+    // a value the consumer has not taken yet. Kept off the producer's and the
+    // consumer's cache lines.
+    alignas(64) std::atomic<int> middle;
+    alignas(64) int backIndex;
+    alignas(64) int frontIndex;
+};
+
+#endif // SNAPSHOTSLOT_H
@@ -0,0 +1,213 @@
+#include "steadystate.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+// Heap order for the elite slots, the worst elite ends up at the front
+struct worstEliteFirst {
+    const vector<proteinNode> *population;
+    bool operator()(int a, int b) const {
+        return (*population)[a].fitness < (*population)[b].fitness;
+    }
+};
+
+
+void SteadyStateEngine::WorstTree::build(const vector<proteinNode> &population, const vector<char> &isElite) {
+    this->population = &population;
+    this->isElite = &isElite;
+
+    numLeaves = 1;
+    while(numLeaves < (int)population.size()) {
+        numLeaves *= 2;
+    }
+
+    nodes.assign(2 * numLeaves, -1);
+    for(int i=0;i<(int)population.size();i++) {
+        nodes[numLeaves + i] = i;
+    }
+    for(int i=numLeaves-1;i>=1;i--) {
+        nodes[i] = loser(nodes[2*i], nodes[2*i+1]);
+    }
+}
+
+// Replays the matches on the way from a changed slot up to the root
+void SteadyStateEngine::WorstTree::update(int slot) {
+    for(int i=(numLeaves + slot)/2;i>=1;i/=2) {
+        nodes[i] = loser(nodes[2*i], nodes[2*i+1]);
+    }
+}
+
+// The less fit of two slots, elites and padding never "win" a match
+int SteadyStateEngine::WorstTree::loser(int a, int b) const {
+    if(a < 0 || (*isElite)[a]) {
+        return b;
+    }
+    if(b < 0 || (*isElite)[b]) {
+        return a;
+    }
+    return (*population)[a].fitness >= (*population)[b].fitness ? a : b;
+}
+
+
+
+SteadyStateEngine::SteadyStateEngine(const string &proteinSequence, int targetFitness, const foldingOptions &options) :
+    FoldingEngine(targetFitness),
+    proteinSequence(proteinSequence),
+    hIndex(buildContactIndex(proteinSequence, getEnergyModel(options))),
+    options(options),
+    bestSlot(0),
+    generationNum(0),
+    numReplaced(0)
+{
+    int popNum = max(2, options.popNum);
+    currSize = proteinSequence.size();
+    numBirths = options.steadyBirths > 0 ? options.steadyBirths : popNum;
+
+    // known has to hold every fold exactly once, so duplicates are drawn again
+    // like the GA's duplicate check does. A chain too short to have popNum
+    // distinct folds gets a smaller population instead.
+    vector<proteinNode> initialPop = generateInitialPop(popNum, currSize, options.maxFitnessLimit);
+    for(int i=0;i<popNum;i++) {
+        proteinNode &node = initialPop[i];
+        for(int t=0;t<options.numToTry && known.count(node.proteinDirection) > 0;t++) {
+            node.proteinDirection = createRandomSequence(currSize, options.maxFitnessLimit);
+        }
+        if(known.insert(node.proteinDirection).second) {
+            node.fitness = getFitnessRating(hIndex, node.proteinDirection);
+            population.push_back(node);
+        }
+    }
+    popNum = population.size();
+
+    numElite = (options.elitePercentage/100.0) * popNum;
+    // At least one slot has to stay open for children
+    numElite = min(max(numElite, 0), popNum - 1);
+
+    // The only full ordering this engine does: pick the initial elites
+    vector<int> order(popNum);
+    for(int i=0;i<popNum;i++) {
+        order[i] = i;
+    }
+    partial_sort(order.begin(), order.begin() + numElite + 1, order.end(), [this](int a, int b) {
+        return population[a].fitness < population[b].fitness;
+    });
+    bestSlot = order[0];
+
+    isElite.assign(popNum, 0);
+    for(int i=0;i<numElite;i++) {
+        isElite[order[i]] = 1;
+        eliteHeap.push_back(order[i]);
+    }
+    worstEliteFirst heapOrder = {&population};
+    make_heap(eliteHeap.begin(), eliteHeap.end(), heapOrder);
+
+    worstTree.build(population, isElite);
+}
+
+
+// Half the parents come from the elites, the rest win a binary tournament
+int SteadyStateEngine::grabParent() {
+    if(numElite > 0 && foldRand() % 2 == 0) {
+        return eliteHeap[foldRand() % numElite];
+    }
+
+    int a = foldRand() % population.size();
+    int b = foldRand() % population.size();
+    return population[a].fitness <= population[b].fitness ? a : b;
+}
+
+
+// Crosses two different parents, a random fold if no pair works within numToTry
+proteinNode SteadyStateEngine::breedChild() {
+    for(int i=0;i<options.numToTry;i++) {
+        int parent1 = grabParent();
+        int parent2 = grabParent();
+        if(population[parent1].proteinDirection == population[parent2].proteinDirection) {
+            continue;
+        }
+
+        proteinNode child = crossover(population[parent1], population[parent2], options.numToTry, options.maxFitnessLimit, hIndex);
+        if(child.proteinDirection != "failed") {
+            return child;
+        }
+    }
+
+    proteinNode child;
+    child.proteinDirection = createRandomSequence(currSize, options.maxFitnessLimit);
+    return child;
+}
+
+
+// Puts a scored child in place of the worst non-elite, if it is no worse and not already there
+void SteadyStateEngine::insertChild(const proteinNode &child) {
+    if(known.count(child.proteinDirection) > 0) {
+        return;
+    }
+
+    int victim = worstTree.worst();
+    if(child.fitness > population[victim].fitness) {
+        return;
+    }
+
+    known.erase(population[victim].proteinDirection);
+    population[victim] = child;
+    known.insert(child.proteinDirection);
+    numReplaced++;
+
+    // Better than the worst elite: the child takes its place and the old elite rejoins the rest
+    if(numElite > 0 && child.fitness < population[eliteHeap[0]].fitness) {
+        worstEliteFirst heapOrder = {&population};
+        pop_heap(eliteHeap.begin(), eliteHeap.end(), heapOrder);
+        int demoted = eliteHeap.back();
+        eliteHeap.back() = victim;
+        push_heap(eliteHeap.begin(), eliteHeap.end(), heapOrder);
+
+        isElite[demoted] = 0;
+        isElite[victim] = 1;
+        worstTree.update(demoted);
+    }
+    worstTree.update(victim);
+
+    if(child.fitness < population[bestSlot].fitness) {
+        bestSlot = victim;
+    }
+}
+
+
+bool SteadyStateEngine::step() {
+    generationNum++;
+    numReplaced = 0;
+
+    for(int i=0;i<numBirths && !isSolved();i++) {
+        proteinNode child;
+        if((int)(foldRand() % 100) < options.crossoverPercentage) {
+            child = breedChild();
+        } else {
+            child.proteinDirection = createRandomSequence(currSize, options.maxFitnessLimit);
+        }
+
+        if((int)(foldRand() % 100) < options.mutatePercentage) {
+            string mutated = mutate(child.proteinDirection, options.numToTry, options.maxFitnessLimit);
+            if(mutated != "failed") {
+                child.proteinDirection = mutated;
+            }
+        }
+
+        child.fitness = getFitnessRating(hIndex, child.proteinDirection);
+        insertChild(child);
+    }
+
+    return isSolved();
+}
+
+
+void SteadyStateEngine::seedFolds(const vector<string> &folds) {
+    for(size_t i=0;i<folds.size();i++) {
+        proteinNode seed;
+        seed.proteinDirection = folds[i];
+        seed.fitness = getFitnessRating(hIndex, seed.proteinDirection);
+        insertChild(seed);
+    }
+}
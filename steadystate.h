@@ -0,0 +1,84 @@
+#ifndef STEADYSTATE_H
+#define STEADYSTATE_H
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+#include "foldingengine.h"
+
+// Steady-state GA: instead of rebuilding and resorting the whole population
+// every generation, children are made one at a time and each replaces the
+// current worst non-elite, so the population is never copied or sorted.
+//
+// The same percentages as the GA are used as rates per child:
+//   crossoverPercentage  chance a child is bred, otherwise it is a random fold
+//   mutatePercentage     chance the child is mutated afterwards
+//   elitePercentage      size of the protected elite set, which is also where
+//                        half of the parents come from
+//
+// Ordering is kept incrementally: the elites sit in a max-heap (worst elite on
+// top) and the rest in a tournament tree whose root is the worst individual,
+// so promoting a child into the elites and finding the slot to replace are
+// both O(log popNum). A step() is steadyBirths children (popNum by default),
+// about one generation of the GA.
+class SteadyStateEngine : public FoldingEngine
+{
+public:
+    SteadyStateEngine(const std::string &proteinSequence, int targetFitness, const foldingOptions &options);
+
+    bool step();
+    void seedFolds(const std::vector<std::string> &folds);
+
+    const proteinNode &best() const { return population[bestSlot]; }
+    int generation() const { return generationNum; }
+
+    const std::vector<proteinNode> &getPopulation() const { return population; }
+    // Children that made it into the population in the last step()
+    int lastReplacements() const { return numReplaced; }
+
+private:
+    // Winner tree over the non-elite slots, the root holds the worst one
+    class WorstTree
+    {
+    public:
+        void build(const std::vector<proteinNode> &population, const std::vector<char> &isElite);
+        void update(int slot);
+        int worst() const { return nodes[1]; }
+
+    private:
+        int loser(int a, int b) const;
+
+        const std::vector<proteinNode> *population;
+        const std::vector<char> *isElite;
+        int numLeaves;
+        // nodes[1] is the root, leaf i sits at numLeaves + i, -1 for padding
+        std::vector<int> nodes;
+    };
+
+    proteinNode breedChild();
+    int grabParent();
+    void insertChild(const proteinNode &child);
+
+    std::string proteinSequence;
+    contactIndex hIndex;
+    foldingOptions options;
+
+    int currSize;
+    int numElite;
+    int numBirths;
+
+    std::vector<proteinNode> population;
+    std::vector<char> isElite;
+    // Slots of the elites, heap ordered with the worst elite at the front
+    std::vector<int> eliteHeap;
+    WorstTree worstTree;
+    // Folds currently in the population, children already there are dropped
+    std::unordered_set<std::string> known;
+
+    int bestSlot;
+    int generationNum;
+    int numReplaced;
+};
+
+#endif // STEADYSTATE_H
@@ -0,0 +1,366 @@
+#include "tuner.h"
+#include "memorybudget.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+using namespace std;
+
+
+// One configuration in the race, scores[b] is its result on block b
+struct raceConfig {
+    // Index into each parameter's values, -1 for the base options' value
+    vector<int> choice;
+    foldingOptions options;
+    vector<double> scores;
+    vector<char> solved;
+    bool alive;
+};
+
+struct raceTask {
+    int config;
+    int block;
+};
+
+
+bool loadTuningParameters(const string &filename, vector<tuningParameter> &parameters, string &error) {
+    ifstream rangesFile(filename.c_str());
+    if(!rangesFile.is_open()) {
+        error = "Error opening file: " + filename + "\n" + "ERROR: " + strerror(errno);
+        return false;
+    }
+
+    parameters.clear();
+    string lineInput;
+    int lineNum = 0;
+    while(getline(rangesFile, lineInput)) {
+        lineNum++;
+        istringstream line(lineInput);
+        string key, equals, value;
+        if(!(line >> key) || key[0] == '#') {
+            continue;
+        }
+        if(!(line >> equals >> value) || equals != "=") {
+            error = "Error in tuning ranges " + filename + " line " + to_string(lineNum) + ": expected \"key = values\"";
+            return false;
+        }
+
+        tuningParameter parameter;
+        parameter.key = key;
+        int rangeMin, rangeMax, rangeStep;
+        char colon1, colon2;
+        istringstream range(value);
+        if(value.find(':') != string::npos) {
+            if(!(range >> rangeMin >> colon1 >> rangeMax >> colon2 >> rangeStep) || colon1 != ':' || colon2 != ':' ||
+               rangeStep <= 0 || rangeMin > rangeMax) {
+                error = "Error in tuning ranges " + filename + " line " + to_string(lineNum) + ": expected \"min:max:step\"";
+                return false;
+            }
+            for(int v=rangeMin;v<=rangeMax;v+=rangeStep) {
+                parameter.values.push_back(to_string(v));
+            }
+        } else {
+            string item;
+            while(getline(range, item, ',')) {
+                if(!item.empty()) {
+                    parameter.values.push_back(item);
+                }
+            }
+        }
+
+        // Every value has to be something the engines accept
+        foldingOptions check;
+        for(size_t i=0;i<parameter.values.size();i++) {
+            bool known;
+            try {
+                known = applyOption(check, key, parameter.values[i]);
+            } catch(const exception &) {
+                error = "Error in tuning ranges " + filename + " line " + to_string(lineNum) + ": bad value " + parameter.values[i];
+                return false;
+            }
+            if(!known) {
+                error = "Error in tuning ranges " + filename + " line " + to_string(lineNum) + ": " + key + " is not a search option";
+                return false;
+            }
+        }
+        if(parameter.values.empty()) {
+            error = "Error in tuning ranges " + filename + " line " + to_string(lineNum) + ": no values";
+            return false;
+        }
+        parameters.push_back(parameter);
+    }
+
+    if(parameters.empty()) {
+        error = "Error in tuning ranges " + filename + ": nothing to tune";
+        return false;
+    }
+    return true;
+}
+
+
+// Seconds until options reach the case's target, stopping at runSeconds
+static double timeRun(const sequenceCase &testCase, const foldingOptions &options, unsigned int seed, double runSeconds, bool &solved) {
+    seedFoldRand(seed);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    unique_ptr<FoldingEngine> engine = createEngine(options.engine, testCase.sequence, testCase.targetFitness, options);
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    while(!engine->isSolved() && elapsed < runSeconds) {
+        engine->step();
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    solved = engine->isSolved();
+    return elapsed;
+}
+
+static string describeConfig(const raceConfig &config, const vector<tuningParameter> &parameters) {
+    string text;
+    for(size_t k=0;k<parameters.size();k++) {
+        text += (k > 0 ? " " : "") + parameters[k].key + "=" +
+                (config.choice[k] < 0 ? string("(current)") : parameters[k].values[config.choice[k]]);
+    }
+    return text;
+}
+
+static double meanScore(const raceConfig &config, int numBlocks) {
+    double total = 0;
+    for(int b=0;b<numBlocks;b++) {
+        total += config.scores[b];
+    }
+    return total / numBlocks;
+}
+
+
+bool runTuning(const vector<sequenceCase> &benchmark, const foldingOptions &baseOptions,
+               const vector<tuningParameter> &parameters, const tuningOptions &tuning,
+               tuningResult &result, string &error) {
+    if(benchmark.empty()) {
+        error = "Error tuning: no benchmark sequences";
+        return false;
+    }
+    for(size_t i=0;i<benchmark.size();i++) {
+        if(benchmark[i].targetFitness >= 0) {
+            error = "Error tuning: benchmark sequence " + to_string(benchmark[i].index + 1) + " has no target fitness";
+            return false;
+        }
+    }
+    if(!hasEngine(baseOptions.engine)) {
+        error = "Error tuning: unknown engine " + baseOptions.engine;
+        return false;
+    }
+
+    seedFoldRand(tuning.seed);
+    int numWorkers = tuning.numWorkers > 0 ? tuning.numWorkers : max(1u, thread::hardware_concurrency());
+    int numBlocks = max(1, tuning.maxBlocks);
+    int minBlocks = max(2, tuning.minBlocks);
+
+    // The starting options, then the whole grid or a random sample of it
+    vector<raceConfig> configs;
+    raceConfig baseConfig;
+    baseConfig.choice.assign(parameters.size(), -1);
+    configs.push_back(baseConfig);
+
+    double gridSize = 1;
+    for(size_t k=0;k<parameters.size();k++) {
+        gridSize *= parameters[k].values.size();
+    }
+    set<vector<int>> picked;
+    if(gridSize <= tuning.numConfigs) {
+        for(long g=0;g<(long)gridSize;g++) {
+            vector<int> choice(parameters.size());
+            long rest = g;
+            for(size_t k=0;k<parameters.size();k++) {
+                choice[k] = rest % parameters[k].values.size();
+                rest /= parameters[k].values.size();
+            }
+            picked.insert(choice);
+        }
+    } else {
+        while((int)picked.size() < tuning.numConfigs) {
+            vector<int> choice(parameters.size());
+            for(size_t k=0;k<parameters.size();k++) {
+                choice[k] = foldRand() % parameters[k].values.size();
+            }
+            picked.insert(choice);
+        }
+    }
+    for(set<vector<int>>::iterator it=picked.begin();it!=picked.end();it++) {
+        raceConfig config;
+        config.choice = *it;
+        configs.push_back(config);
+    }
+
+    // Runs go side by side on the workers, so every engine gets one thread
+    // unless engineThreads is tuned itself. Pools sized to the cores would
+    // oversubscribe them and skew the timings, and one thread per engine
+    // also makes the same seed give the same run for every configuration.
+    foldingOptions pinnedOptions = baseOptions;
+    if(pinnedOptions.engineThreads <= 0) {
+        pinnedOptions.engineThreads = 1;
+    }
+    for(size_t c=0;c<configs.size();c++) {
+        configs[c].options = pinnedOptions;
+        for(size_t k=0;k<parameters.size();k++) {
+            if(configs[c].choice[k] >= 0) {
+                applyOption(configs[c].options, parameters[k].key, parameters[k].values[configs[c].choice[k]]);
+            }
+        }
+        configs[c].alive = hasEngine(configs[c].options.engine);
+    }
+
+    fprintf(stderr, "Tuning %d configurations on %d sequences with %d workers\n",
+            (int)configs.size(), (int)benchmark.size(), numWorkers);
+
+    // Race: every round adds blocks for the configurations still in, enough to keep the workers busy
+    int blocksRun = 0;
+    int numAlive = configs.size();
+    int leader = 0;
+    while(blocksRun < numBlocks && numAlive > 1) {
+        int newBlocks = min(numBlocks - blocksRun, max(1, (numWorkers + numAlive - 1) / numAlive));
+
+        vector<raceTask> tasks;
+        for(size_t c=0;c<configs.size();c++) {
+            if(!configs[c].alive) {
+                continue;
+            }
+            configs[c].scores.resize(blocksRun + newBlocks);
+            configs[c].solved.resize(blocksRun + newBlocks);
+            for(int b=blocksRun;b<blocksRun+newBlocks;b++) {
+                tasks.push_back({(int)c, b});
+            }
+        }
+
+        // Longest configurations are not known up front, so workers just pull the next task
+        atomic<size_t> nextTask(0);
+        vector<thread> workers;
+        for(int w=0;w<numWorkers;w++) {
+            workers.emplace_back([&]() {
+                size_t t;
+                while((t = nextTask++) < tasks.size()) {
+                    raceConfig &config = configs[tasks[t].config];
+                    int block = tasks[t].block;
+                    // Same case and seed for the whole block, so configurations are compared like for like
+                    const sequenceCase &testCase = benchmark[block % benchmark.size()];
+                    // Fewer runs at once rather than more memory than the budget
+                    size_t jobBytes = estimateSearchBytes(config.options.engine, testCase.sequence.size(), config.options);
+                    memoryGate().acquire(jobBytes);
+                    bool solved;
+                    double seconds = timeRun(testCase, config.options, tuning.seed * 1000003u + block, tuning.runSeconds, solved);
+                    memoryGate().release(jobBytes);
+                    config.scores[block] = solved ? seconds : tuning.penalty * tuning.runSeconds;
+                    config.solved[block] = solved;
+                }
+            });
+        }
+        for(size_t w=0;w<workers.size();w++) {
+            workers[w].join();
+        }
+        blocksRun += newBlocks;
+
+        leader = -1;
+        for(size_t c=0;c<configs.size();c++) {
+            if(configs[c].alive && (leader < 0 || meanScore(configs[c], blocksRun) < meanScore(configs[leader], blocksRun))) {
+                leader = c;
+            }
+        }
+
+        // Drop everything clearly slower than the leader on the same blocks
+        if(blocksRun >= minBlocks) {
+            for(size_t c=0;c<configs.size();c++) {
+                if(!configs[c].alive || (int)c == leader) {
+                    continue;
+                }
+                double mean = meanScore(configs[c], blocksRun) - meanScore(configs[leader], blocksRun);
+                double variance = 0;
+                for(int b=0;b<blocksRun;b++) {
+                    double difference = configs[c].scores[b] - configs[leader].scores[b] - mean;
+                    variance += difference * difference;
+                }
+                double standardError = sqrt(variance / (blocksRun - 1) / blocksRun);
+                if(mean > 0 && mean > tuning.dropThreshold * standardError) {
+                    configs[c].alive = false;
+                }
+            }
+        }
+
+        numAlive = 0;
+        for(size_t c=0;c<configs.size();c++) {
+            numAlive += configs[c].alive;
+        }
+        fprintf(stderr, "Tuning: %d blocks, %d of %d configurations left, leader %.3fs: %s\n", blocksRun, numAlive,
+                (int)configs.size(), meanScore(configs[leader], blocksRun), describeConfig(configs[leader], parameters).c_str());
+    }
+
+    const raceConfig &winner = configs[leader];
+    result.values.clear();
+    result.options = winner.options;
+    // The one thread per engine was only for the race
+    result.options.engineThreads = baseOptions.engineThreads;
+    for(size_t k=0;k<parameters.size();k++) {
+        result.values.push_back(winner.choice[k] < 0 ? string() : parameters[k].values[winner.choice[k]]);
+        if(parameters[k].key == "engineThreads" && winner.choice[k] >= 0) {
+            result.options.engineThreads = winner.options.engineThreads;
+        }
+    }
+    result.meanScore = blocksRun > 0 ? meanScore(winner, blocksRun) : 0;
+    result.solvedRuns = count(winner.solved.begin(), winner.solved.end(), 1);
+    result.totalRuns = winner.solved.size();
+    result.configsRaced = configs.size();
+    result.blocksRun = blocksRun;
+    return true;
+}
+
+
+bool writeTunedOptions(const string &optionsFilename, const string &outputFilename,
+                       const vector<tuningParameter> &parameters, const tuningResult &result,
+                       string &error) {
+    vector<char> written(parameters.size(), 0);
+    vector<string> lines;
+
+    // A missing options file just means everything else stays at its default
+    ifstream optionsFile(optionsFilename.c_str());
+    string lineInput;
+    while(getline(optionsFile, lineInput)) {
+        istringstream line(lineInput);
+        string key;
+        line >> key;
+        for(size_t k=0;k<parameters.size();k++) {
+            if(key == parameters[k].key && !result.values[k].empty()) {
+                lineInput = key + " = " + result.values[k];
+                written[k] = 1;
+            }
+        }
+        lines.push_back(lineInput);
+    }
+    for(size_t k=0;k<parameters.size();k++) {
+        if(!written[k] && !result.values[k].empty()) {
+            lines.push_back(parameters[k].key + " = " + result.values[k]);
+        }
+    }
+
+    ofstream outputFile(outputFilename.c_str());
+    if(!outputFile.is_open()) {
+        error = "Error opening file: " + outputFilename + "\n" + "ERROR: " + strerror(errno);
+        return false;
+    }
+    for(size_t i=0;i<lines.size();i++) {
+        outputFile << lines[i] << "\n";
+    }
+    outputFile.close();
+    if(outputFile.fail()) {
+        error = "Error writing file: " + outputFilename;
+        return false;
+    }
+    return true;
+}
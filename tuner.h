@@ -0,0 +1,74 @@
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <string>
+#include <vector>
+
+#include "foldingengine.h"
+#include "sequencestream.h"
+
+// One tuned option and the values it may take. Read from a ranges file with
+// the same "key = value" lines as Options.txt, where value is either a list
+// "a,b,c" or an integer range "min:max:step", e.g.
+//   popNum = 100:800:100
+//   mutatePercentage = 30,50,70
+//   engine = ga,steady
+struct tuningParameter {
+    std::string key;
+    std::vector<std::string> values;
+};
+
+struct tuningOptions {
+    // Configurations raced, sampled from the grid (all of it if it is smaller).
+    // The options the tuner started from always take part as well.
+    int numConfigs = 24;
+
+    // Runs in parallel, 0 for one per core. Each run's engine gets one thread
+    // unless engineThreads is set or tuned
+    int numWorkers = 0;
+
+    // Wall-clock budget of one run, runs that miss the target score penalty times this
+    double runSeconds = 10.0;
+    double penalty = 10.0;
+
+    // A block is one run of every configuration still in the race on the same
+    // benchmark case with the same seed. Nothing is dropped before minBlocks,
+    // the race ends after maxBlocks.
+    int minBlocks = 3;
+    int maxBlocks = 30;
+
+    // Configurations are dropped once their paired difference to the leader
+    // is this many standard errors above zero
+    double dropThreshold = 2.0;
+
+    unsigned int seed = 1;
+};
+
+struct tuningResult {
+    // Value picked for every tuned key, in the order of the parameters
+    std::vector<std::string> values;
+    foldingOptions options;
+
+    // Mean score in seconds (penalised for misses) over the blocks it ran
+    double meanScore;
+    int solvedRuns;
+    int totalRuns;
+    int configsRaced;
+    int blocksRun;
+};
+
+bool loadTuningParameters(const std::string &filename, std::vector<tuningParameter> &parameters, std::string &error);
+
+// Races configurations of the base options over the benchmark cases (which all
+// need a target fitness) and picks the one with the best time-to-target
+bool runTuning(const std::vector<sequenceCase> &benchmark, const foldingOptions &baseOptions,
+               const std::vector<tuningParameter> &parameters, const tuningOptions &tuning,
+               tuningResult &result, std::string &error);
+
+// Copies optionsFilename to outputFilename with the tuned keys set to the
+// winning values, keys that were not in the file are added at the end
+bool writeTunedOptions(const std::string &optionsFilename, const std::string &outputFilename,
+                       const std::vector<tuningParameter> &parameters, const tuningResult &result,
+                       std::string &error);
+
+#endif // TUNER_H
@@ -0,0 +1,442 @@
+#include "wanglandau.h"
+
+#include <cmath>
+#include <climits>
+#include <algorithm>
+
+using namespace std;
+
+
+static int greatestCommonDivisor(int a, int b) {
+    while(b != 0) {
+        int rest = a % b;
+        a = b;
+        b = rest;
+    }
+    return a;
+}
+
+// The same fold turned and mirrored so it starts east and first turns south,
+// so the eight copies of one fold count as one
+static string canonicalFold(const string &proteinDirection) {
+    string canonical = proteinDirection;
+    if(canonical.empty() || canonical[0] < '1' || canonical[0] > '4') {
+        return canonical;
+    }
+
+    // Directions go round clockwise, so turning is adding to all of them
+    int turn = '2' - canonical[0] + 4;
+    for(size_t i=0;i<canonical.size();i++) {
+        if(canonical[i] >= '1' && canonical[i] <= '4') {
+            canonical[i] = '1' + (canonical[i] - '1' + turn) % 4;
+        }
+    }
+
+    size_t firstTurn = canonical.find_first_not_of('2');
+    if(firstTurn != string::npos && canonical[firstTurn] == '1') {
+        for(size_t i=0;i<canonical.size();i++) {
+            if(canonical[i] == '1') {
+                canonical[i] = '3';
+            } else if(canonical[i] == '3') {
+                canonical[i] = '1';
+            }
+        }
+    }
+    return canonical;
+}
+
+
+WangLandauEngine::WangLandauEngine(const string &proteinSequence, int targetFitness, const foldingOptions &options) :
+    FoldingEngine(targetFitness),
+    proteinSequence(proteinSequence),
+    hIndex(buildContactIndex(proteinSequence, getEnergyModel(options))),
+    options(options),
+    numWindows(max(1, options.wlWindows > 0 ? options.wlWindows : (int)thread::hardware_concurrency())),
+    windowsSplit(false),
+    roundNum(0),
+    pool(min(numWindows, engineThreadCount(options)))
+{
+    // Every energy is a sum of pair energies, so their common divisor is the finest useful bin
+    binWidth = 0;
+    int minPair = 0;
+    int maxPair = 0;
+    for(size_t p=0;p<hIndex.pairEnergy.size();p++) {
+        binWidth = greatestCommonDivisor(binWidth, abs(hIndex.pairEnergy[p]));
+        minPair = min(minPair, hIndex.pairEnergy[p]);
+        maxPair = max(maxPair, hIndex.pairEnergy[p]);
+    }
+    binWidth = max(1, binWidth);
+
+    // Contacts join an even and an odd residue, and a residue has at most two
+    // neighbours off the chain (three at the ends)
+    int maxContacts = 2 * min(hIndex.evenSlots.size(), hIndex.oddSlots.size());
+    if(maxContacts > 0) {
+        maxContacts += 2;
+    }
+    minFitness = maxContacts * minPair;
+    numBins = (maxContacts * maxPair - minFitness) / binWidth + 1;
+
+    windows.resize(numWindows);
+    chainAt.resize(numWindows);
+    swapsAccepted.assign(numWindows, 0);
+    swapsAttempted.assign(numWindows, 0);
+
+    int currSize = proteinSequence.size();
+    for(int k=0;k<numWindows;k++) {
+        window &w = windows[k];
+        w.lowBin = 0;
+        w.highBin = numBins - 1;
+        w.logG.assign(numBins, 0);
+        w.histogram.assign(numBins, 0);
+        w.visited.assign(numBins, 0);
+        w.logF = 1;
+        w.moves = 0;
+        w.accepted = 0;
+        w.lowestFitness = INT_MAX;
+
+        string fold = createRandomSequence(currSize, options.maxFitnessLimit);
+        chains.push_back(unique_ptr<LatticeChain>(new LatticeChain(hIndex, fold)));
+        chainFitness.push_back(getFitnessRating(hIndex, fold));
+        chainAt[k] = k;
+        noteFold(w, k);
+
+        if(k == 0 || chainFitness[k] < bestNode.fitness) {
+            bestNode.proteinDirection = w.lowestFolds[0];
+            bestNode.fitness = chainFitness[k];
+        }
+    }
+}
+
+
+bool WangLandauEngine::isConverged() const {
+    return windowsSplit && getLogF() < options.wlFinalLogF;
+}
+
+double WangLandauEngine::getLogF() const {
+    double logF = 0;
+    for(int k=0;k<numWindows;k++) {
+        logF = max(logF, windows[k].logF);
+    }
+    return logF;
+}
+
+long WangLandauEngine::getMoves() const {
+    long moves = 0;
+    for(int k=0;k<numWindows;k++) {
+        moves += windows[k].moves;
+    }
+    return moves;
+}
+
+double WangLandauEngine::getSwapRate(int k) const {
+    if(swapsAttempted[k] == 0) {
+        return 0;
+    }
+    return (double)swapsAccepted[k] / swapsAttempted[k];
+}
+
+
+// One sweep of a window by the walker sitting in it
+void WangLandauEngine::walkWindow(int windowIndex) {
+    window &w = windows[windowIndex];
+    sweep(w, chainAt[windowIndex]);
+    if(checkFlat(w)) {
+        w.logF /= 2;
+    }
+}
+
+
+void WangLandauEngine::sweep(window &w, int walker) {
+    LatticeChain &chain = *chains[walker];
+    int &fitness = chainFitness[walker];
+    int length = chain.size();
+
+    for(int m=0;m<options.wlMovesPerExchange;m++) {
+        w.moves++;
+        int bin = binOf(fitness);
+        bool inside = bin >= w.lowBin && bin <= w.highBin;
+
+        int fitnessChange;
+        if(chain.randomMoveAt(foldRand() % length, fitnessChange)) {
+            int newBin = binOf(fitness + fitnessChange);
+            bool accept;
+            if(inside) {
+                // Towards the energies seen less often, never out of the window
+                double logRatio = w.logG[bin] - w.logG[newBin];
+                accept = newBin >= w.lowBin && newBin <= w.highBin &&
+                         (logRatio >= 0 || foldRand() / 2147483648.0 < exp(logRatio));
+            } else {
+                // Still walking in from where the walker was before the windows were split
+                int distance = bin < w.lowBin ? w.lowBin - bin : bin - w.highBin;
+                int newDistance = newBin < w.lowBin ? w.lowBin - newBin : max(0, newBin - w.highBin);
+                accept = newDistance <= distance;
+            }
+
+            if(accept) {
+                fitness += fitnessChange;
+                bin = newBin;
+                inside = bin >= w.lowBin && bin <= w.highBin;
+                w.accepted++;
+                if(fitness <= w.lowestFitness) {
+                    noteFold(w, walker);
+                }
+            } else {
+                chain.undoMove();
+            }
+        }
+
+        // A rejected move counts as another visit to the energy the walker stayed at
+        if(inside) {
+            w.logG[bin] += w.logF;
+            w.histogram[bin]++;
+            w.visited[bin] = 1;
+        }
+    }
+}
+
+
+// Flat once every energy the window has ever reached has been visited at
+// least wlFlatness times the mean since the last halving. Energies no walker
+// has reached yet (or that do not exist) are left out.
+bool WangLandauEngine::checkFlat(window &w) {
+    long total = 0;
+    long lowest = LONG_MAX;
+    int numVisited = 0;
+    for(int b=w.lowBin;b<=w.highBin;b++) {
+        if(!w.visited[b]) {
+            continue;
+        }
+        total += w.histogram[b];
+        lowest = min(lowest, w.histogram[b]);
+        numVisited++;
+    }
+    if(numVisited == 0 || lowest < options.wlFlatness * total / numVisited) {
+        return false;
+    }
+
+    fill(w.histogram.begin(), w.histogram.end(), 0);
+    return true;
+}
+
+
+void WangLandauEngine::noteFold(window &w, int walker) {
+    int fitness = chainFitness[walker];
+    // Anything above the lowest energy would be listed under it
+    if(fitness > w.lowestFitness) {
+        return;
+    }
+    if(fitness < w.lowestFitness) {
+        w.lowestFitness = fitness;
+        w.lowestFolds.clear();
+    }
+    if((int)w.lowestFolds.size() >= max(1, options.wlKeepFolds)) {
+        return;
+    }
+
+    string fold = canonicalFold(chains[walker]->getDirections());
+    if(find(w.lowestFolds.begin(), w.lowestFolds.end(), fold) == w.lowestFolds.end()) {
+        w.lowestFolds.push_back(fold);
+    }
+}
+
+
+// Lays the windows over the energies found, overlapping by wlOverlap
+void WangLandauEngine::splitWindows() {
+    int seenLow = numBins;
+    int seenHigh = -1;
+    for(int k=0;k<numWindows;k++) {
+        for(int b=0;b<numBins;b++) {
+            if(windows[k].visited[b]) {
+                seenLow = min(seenLow, b);
+                seenHigh = max(seenHigh, b);
+            }
+        }
+    }
+
+    double overlap = min(0.95, max(0.0, options.wlOverlap));
+    double width = (seenHigh - seenLow + 1) / (1 + (numWindows - 1) * (1 - overlap));
+    for(int k=0;k<numWindows;k++) {
+        window &w = windows[k];
+        w.lowBin = seenLow + (int)(k * (1 - overlap) * width);
+        w.highBin = min(seenHigh, max(w.lowBin + 1, seenLow + (int)ceil(k * (1 - overlap) * width + width) - 1));
+        w.lowBin = min(w.lowBin, max(seenLow, w.highBin - 1));
+        fill(w.histogram.begin(), w.histogram.end(), 0);
+    }
+    windows[0].lowBin = 0;
+    windows[numWindows-1].highBin = numBins - 1;
+
+    // Lowest energy walker to the lowest window and so on, so they hardly have to walk in
+    vector<int> order(numWindows);
+    for(int k=0;k<numWindows;k++) {
+        order[k] = chainAt[k];
+    }
+    sort(order.begin(), order.end(), [&](int a, int b) { return chainFitness[a] < chainFitness[b]; });
+    chainAt = order;
+
+    windowsSplit = true;
+}
+
+
+bool WangLandauEngine::step() {
+    // One sweep of every window, spread over the pool
+    pool.run(numWindows, [this](int k, int) { walkWindow(k); });
+
+    roundNum++;
+
+    if(!windowsSplit) {
+        // Once every window has been flat over the whole range, the range is known well enough
+        bool allFlat = true;
+        for(int k=0;k<numWindows;k++) {
+            allFlat = allFlat && windows[k].logF < 1;
+        }
+        if(allFlat) {
+            splitWindows();
+        }
+    } else {
+        // Neighbour swaps, alternating even and odd pairs. Both walkers have
+        // to be inside the other's window.
+        for(int k=roundNum%2;k+1<numWindows;k+=2) {
+            const window &low = windows[k];
+            const window &high = windows[k+1];
+            int a = chainAt[k];
+            int b = chainAt[k+1];
+            int binA = binOf(chainFitness[a]);
+            int binB = binOf(chainFitness[b]);
+
+            swapsAttempted[k]++;
+            if(binA < high.lowBin || binA > high.highBin || binB < low.lowBin || binB > low.highBin) {
+                continue;
+            }
+            double logRatio = low.logG[binA] - low.logG[binB] + high.logG[binB] - high.logG[binA];
+            if(logRatio >= 0 || foldRand() / 2147483648.0 < exp(logRatio)) {
+                chainAt[k] = b;
+                chainAt[k+1] = a;
+                swapsAccepted[k]++;
+            }
+        }
+    }
+
+    for(int k=0;k<numWindows;k++) {
+        if(windows[k].lowestFitness < bestNode.fitness) {
+            bestNode.proteinDirection = windows[k].lowestFolds[0];
+            bestNode.fitness = windows[k].lowestFitness;
+        }
+    }
+
+    return bestNode.fitness <= targetFitness;
+}
+
+
+// Only called between rounds, while the pool is idle
+void WangLandauEngine::seedFolds(const vector<string> &folds) {
+    for(size_t k=0;k<folds.size() && (int)k<numWindows;k++) {
+        int walker = chainAt[k];
+        chains[walker].reset(new LatticeChain(hIndex, folds[k]));
+        chainFitness[walker] = getFitnessRating(hIndex, folds[k]);
+        noteFold(windows[k], walker);
+
+        if(chainFitness[walker] < bestNode.fitness) {
+            bestNode.proteinDirection = folds[k];
+            bestNode.fitness = chainFitness[walker];
+        }
+    }
+}
+
+
+vector<pair<int, double>> WangLandauEngine::getLogDensity() const {
+    vector<double> joined(numBins, 0);
+    vector<char> known(numBins, 0);
+
+    // Before the split the windows are separate estimates of the whole range, the first one will do
+    int numJoined = windowsSplit ? numWindows : 1;
+    for(int k=0;k<numJoined;k++) {
+        const window &w = windows[k];
+
+        // ln g is only known up to a constant per window, match it to the part already joined
+        double offset = 0;
+        int numShared = 0;
+        int sharedHigh = k > 0 ? min(w.highBin, windows[k-1].highBin) : -1;
+        for(int b=w.lowBin;b<=sharedHigh;b++) {
+            if(known[b] && w.visited[b]) {
+                offset += joined[b] - w.logG[b];
+                numShared++;
+            }
+        }
+        offset = numShared > 0 ? offset / numShared : 0;
+
+        // This window takes over from the middle of the overlap up
+        int joinBin = numShared > 0 ? (w.lowBin + sharedHigh + 1) / 2 : w.lowBin;
+        for(int b=joinBin;b<=w.highBin;b++) {
+            if(w.visited[b]) {
+                joined[b] = w.logG[b] + offset;
+                known[b] = 1;
+            }
+        }
+    }
+
+    // Normalise so the g(E) add up to 1
+    double highest = -HUGE_VAL;
+    for(int b=0;b<numBins;b++) {
+        if(known[b]) {
+            highest = max(highest, joined[b]);
+        }
+    }
+    double total = 0;
+    for(int b=0;b<numBins;b++) {
+        if(known[b]) {
+            total += exp(joined[b] - highest);
+        }
+    }
+    double logTotal = highest + log(total);
+
+    vector<pair<int, double>> density;
+    for(int b=0;b<numBins;b++) {
+        if(known[b]) {
+            density.push_back(make_pair(minFitness + b * binWidth, joined[b] - logTotal));
+        }
+    }
+    return density;
+}
+
+vector<proteinNode> WangLandauEngine::getLowestFolds() const {
+    int lowestFitness = INT_MAX;
+    for(int k=0;k<numWindows;k++) {
+        lowestFitness = min(lowestFitness, windows[k].lowestFitness);
+    }
+
+    vector<proteinNode> folds;
+    for(int k=0;k<numWindows;k++) {
+        const window &w = windows[k];
+        if(w.lowestFitness != lowestFitness) {
+            continue;
+        }
+        for(size_t f=0;f<w.lowestFolds.size() && (int)folds.size()<max(1, options.wlKeepFolds);f++) {
+            bool known = false;
+            for(size_t g=0;g<folds.size();g++) {
+                known = known || folds[g].proteinDirection == w.lowestFolds[f];
+            }
+            if(!known) {
+                folds.push_back({w.lowestFolds[f], lowestFitness});
+            }
+        }
+    }
+    return folds;
+}
+
+
+void writeDensityOfStates(ostream &out, const string &proteinSequence, const WangLandauEngine &engine) {
+    out << "sequence " << proteinSequence << "\n";
+    out << "rounds " << engine.generation() << " moves " << engine.getMoves() << " logf " << engine.getLogF()
+        << " converged " << (engine.isConverged() ? 1 : 0) << "\n";
+
+    vector<pair<int, double>> density = engine.getLogDensity();
+    for(size_t i=0;i<density.size();i++) {
+        out << "dos " << density[i].first << " " << density[i].second << "\n";
+    }
+
+    vector<proteinNode> folds = engine.getLowestFolds();
+    for(size_t i=0;i<folds.size();i++) {
+        out << "fold " << folds[i].fitness << " " << folds[i].proteinDirection << "\n";
+    }
+    out << "\n";
+}
@@ -0,0 +1,123 @@
+#ifndef WANGLANDAU_H
+#define WANGLANDAU_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <ostream>
+
+#include "foldingengine.h"
+#include "localsearch.h"
+#include "workerpool.h"
+
+// Wang-Landau sampling of the density of states g(E) of a sequence, with
+// replica exchange between overlapping energy windows (REWL).
+//
+// Every window has its own walker, and the windows are walked in parallel on
+// the engine's worker pool. A walker makes the lattice moves of LatticeChain,
+// scored from the residues they move, and accepts a move from E to E' with
+// min(1, g(E)/g(E')), so it spends equal time at every energy of its window;
+// ln g(E) of the energy it lands on grows by ln f each move. Whenever the
+// window's histogram is flat, ln f halves.
+//
+// The first rounds walk the whole energy range in every window to find out
+// which energies occur. After that the windows split the range found so far
+// (the lowest and highest window reach on to the bounds, in case the walk
+// missed something) and a step() is one round: wlMovesPerExchange moves per
+// walker, then neighbouring windows try to swap walkers (even pairs one round,
+// odd pairs the next), the same as ReplicaExchangeEngine.
+//
+// Energies are binned by the greatest common divisor of the model's pair
+// energies, so every energy the model allows has a bin of its own.
+class WangLandauEngine : public FoldingEngine
+{
+public:
+    WangLandauEngine(const std::string &proteinSequence, int targetFitness, const foldingOptions &options);
+
+    bool step();
+    // Seeds replace the walkers of the lowest windows
+    void seedFolds(const std::vector<std::string> &folds);
+
+    const proteinNode &best() const { return bestNode; }
+    int generation() const { return roundNum; }
+
+    // True once ln f has fallen below wlFinalLogF in every window
+    bool isConverged() const;
+    int getNumWindows() const { return numWindows; }
+    // Largest ln f over the windows
+    double getLogF() const;
+    long getMoves() const;
+    // Fraction of accepted walker swaps between window k and k+1
+    double getSwapRate(int k) const;
+
+    // ln g(E) for every energy seen, lowest first, the windows joined where
+    // they overlap and normalised so the g(E) add up to 1
+    std::vector<std::pair<int, double>> getLogDensity() const;
+    // Distinct folds at the lowest energy seen
+    std::vector<proteinNode> getLowestFolds() const;
+
+private:
+    struct window {
+        // Bins walked, inclusive
+        int lowBin;
+        int highBin;
+
+        std::vector<double> logG;
+        std::vector<long> histogram;
+        std::vector<char> visited;
+        double logF;
+
+        long moves;
+        long accepted;
+
+        // Lowest energy this window's walkers have reached, and distinct folds there
+        int lowestFitness;
+        std::vector<std::string> lowestFolds;
+
+        // Keeps windows on different threads off each other's cache lines
+        char padding[64];
+    };
+
+    int binOf(int fitness) const { return (fitness - minFitness) / binWidth; }
+
+    void walkWindow(int windowIndex);
+    void sweep(window &w, int walker);
+    bool checkFlat(window &w);
+    void noteFold(window &w, int walker);
+    void splitWindows();
+
+    std::string proteinSequence;
+    contactIndex hIndex;
+    foldingOptions options;
+
+    int minFitness;
+    int binWidth;
+    int numBins;
+
+    int numWindows;
+    std::vector<window> windows;
+    // Walkers, their energies, and which walker currently sits in each window
+    std::vector<std::unique_ptr<LatticeChain>> chains;
+    std::vector<int> chainFitness;
+    std::vector<int> chainAt;
+    // Before the split every window walks the whole range
+    bool windowsSplit;
+
+    std::vector<long> swapsAccepted;
+    std::vector<long> swapsAttempted;
+
+    proteinNode bestNode;
+    int roundNum;
+
+    // Last, so it is gone before anything its threads touch
+    WorkerPool pool;
+};
+
+// Writes ln g(E) and the lowest folds of a finished run as plain text:
+//   sequence <sequence>
+//   rounds <n> moves <n> logf <ln f> converged <0|1>
+//   dos <energy> <ln g>          one line per energy, lowest first
+//   fold <energy> <directions>   one line per lowest fold
+void writeDensityOfStates(std::ostream &out, const std::string &proteinSequence, const WangLandauEngine &engine);
+
+#endif // WANGLANDAU_H
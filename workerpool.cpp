@@ -0,0 +1,69 @@
+#include "workerpool.h"
+#include "folding.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+WorkerPool::WorkerPool(int numThreads) :
+    epoch(0),
+    numFinished(0),
+    nextJob(0),
+    quit(false),
+    currentJob(NULL),
+    numJobs(0)
+{
+    for(int t=1;t<max(numThreads, 1);t++) {
+        helpers.push_back(thread(&WorkerPool::helperLoop, this, t, (unsigned int)foldRand()));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    quit = true;
+    epoch.fetch_add(1, memory_order_release);
+    for(size_t t=0;t<helpers.size();t++) {
+        helpers[t].join();
+    }
+}
+
+
+void WorkerPool::helperLoop(int threadIndex, unsigned int seed) {
+    seedFoldRand(seed);
+
+    long seen = 0;
+    while(true) {
+        waitFor([&] { return epoch.load(memory_order_acquire) != seen; });
+        seen = epoch.load(memory_order_acquire);
+        if(quit) {
+            return;
+        }
+
+        runJobs(threadIndex);
+        numFinished.fetch_add(1, memory_order_release);
+    }
+}
+
+void WorkerPool::runJobs(int threadIndex) {
+    int k;
+    while((k = nextJob.fetch_add(1, memory_order_relaxed)) < numJobs) {
+        (*currentJob)(k, threadIndex);
+    }
+}
+
+
+void WorkerPool::run(int jobs, const function<void(int, int)> &job) {
+    currentJob = &job;
+    numJobs = jobs;
+    nextJob.store(0, memory_order_relaxed);
+    if(helpers.empty()) {
+        runJobs(0);
+        return;
+    }
+
+    numFinished.store(0, memory_order_relaxed);
+    epoch.fetch_add(1, memory_order_release);
+    runJobs(0);
+    waitFor([&] { return numFinished.load(memory_order_acquire) == (int)helpers.size(); });
+}
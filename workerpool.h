@@ -0,0 +1,63 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+// Waits for an atomic to move on, spinning briefly before backing off to
+// short sleeps so idle threads (e.g. a daemon job waiting for its next
+// slice) do not burn a core
+template<typename Condition>
+void waitFor(Condition done) {
+    int spins = 0;
+    while(!done()) {
+        if(spins < 1000) {
+            spins++;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+}
+
+// Persistent threads the engines hand their parallel loops to, so an engine
+// pays for its threads once instead of every step.
+//
+// A pool of n threads is the caller plus n - 1 helpers: run() releases the
+// helpers with an epoch counter, takes jobs off the shared counter itself
+// too, and returns once every helper has reported back. A pool of one
+// thread starts no helpers and just runs the jobs in a loop, which is what
+// engines get when their caller already runs several of them side by side.
+//
+// Helpers are seeded from the thread that builds the pool, so a single
+// threaded caller that seeds itself still gets the same run every time.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(int numThreads);
+    ~WorkerPool();
+
+    // Threads that run jobs, the caller included
+    int size() const { return helpers.size() + 1; }
+
+    // Runs job(k, thread) for every k in [0, numJobs), thread being in [0, size())
+    void run(int numJobs, const std::function<void(int, int)> &job);
+
+private:
+    void helperLoop(int threadIndex, unsigned int seed);
+    void runJobs(int threadIndex);
+
+    std::vector<std::thread> helpers;
+    std::atomic<long> epoch;
+    std::atomic<int> numFinished;
+    std::atomic<int> nextJob;
+    std::atomic<bool> quit;
+
+    const std::function<void(int, int)> *currentJob;
+    int numJobs;
+};
+
+#endif // WORKERPOOL_H